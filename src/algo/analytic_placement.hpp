@@ -2,11 +2,12 @@
 #define ALGO__ANALYTIC_PLACEMENT
 
 #include <device/placement_device.hpp>
+#include <util/flat_hash.hpp>
 #include <util/logging.hpp>
+#include <util/memory_usage.hpp>
 #include <util/netlist.hpp>
 #include <util/umfpack_interface.hpp>
 
-#include <unordered_set>
 #include <unordered_map>
 #include <map>
 #include <vector>
@@ -32,7 +33,7 @@ std::unordered_map<device::AtomID, geom::Point<double>> exact_solution(
 	(void) device;
 
 	{
-		std::unordered_set<device::AtomID> seen_before;
+		util::FlatHashSet<device::AtomID> seen_before;
 		int row_index = 0;
 		int next_net_id = 0;
 		for (const auto& atoms : net_members) {
@@ -107,6 +108,13 @@ std::unordered_map<device::AtomID, geom::Point<double>> exact_solution(
 	}
 	col_starts.push_back(col_start); // need to tell it the end
 
+	util::record_memory("placement weight matrix", [&]() {
+		return util::heap_bytes(weight_matrix_columns) + util::heap_bytes(right_hand_side.x) + util::heap_bytes(right_hand_side.y);
+	});
+	util::record_memory("placement weight matrix (compressed)", [&]() {
+		return util::heap_bytes(col_starts) + util::heap_bytes(rows_numbers) + util::heap_bytes(values);
+	});
+
 	if (dout(DL::APL_D4).enabled()) {
 		{const auto indent = dout(DL::APL_D4).indentWithTitle("Matrix & RHS For Solving");
 		for (int irow = 0; irow < (int)movable_atom_row.size(); ++irow) {
@@ -0,0 +1,235 @@
+#ifndef ALGO__INCREMENTAL_ROUTING_H
+#define ALGO__INCREMENTAL_ROUTING_H
+
+#include <algo/routing.hpp>
+#include <device/device.hpp>
+#include <util/flat_hash.hpp>
+#include <util/logging.hpp>
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace algo {
+
+/**
+ * The pin-to-pin connections added and removed by an engineering change
+ */
+struct NetlistDelta {
+	std::vector<std::pair<device::PinGID, device::PinGID>> added = {};
+	std::vector<std::pair<device::PinGID, device::PinGID>> removed = {};
+};
+
+/**
+ * Returns pin_to_pin_netlist with the delta applied
+ */
+template<typename Netlist>
+Netlist apply_delta(Netlist pin_to_pin_netlist, const NetlistDelta& delta) {
+	for (const auto& source_and_sink : delta.removed) {
+		pin_to_pin_netlist.removeConnection(source_and_sink.first, source_and_sink.second);
+	}
+	for (const auto& source_and_sink : delta.added) {
+		pin_to_pin_netlist.addConnection(source_and_sink.first, source_and_sink.second);
+	}
+	return pin_to_pin_netlist;
+}
+
+/**
+ * Keeps a routing up to date as the netlist changes, doing work in proportion to each
+ * change rather than to the design: which net uses each route element is worked out
+ * once, when constructed, and then kept up to date as routes are added and ripped up.
+ *
+ * For each change (see apply), nets that lost a connection are ripped up and rerouted
+ * with what's left of them, and added connections are routed onto their net's existing
+ * routing. Both are routed around what every other net already uses, and every other
+ * net is left as it was.
+ *
+ * If a connection is blocked only by other nets, those nets are ripped up, the
+ * connection takes the route it needs, and then they are rerouted around it (without
+ * ripping up anything else). Whatever still doesn't route ends up in unroutedPins().
+ */
+template<typename Netlist, typename FanoutGenerator>
+class IncrementalRouter {
+public:
+	using PinGID = device::PinGID;
+	using RouteElementID = device::RouteElementID;
+
+	/**
+	 * Start from `previous`, a routing of the netlist as it is now.
+	 * fanout_gen must outlive this.
+	 */
+	IncrementalRouter(RouteAllResult<Netlist> previous, const FanoutGenerator& fanout_gen, int nthreads = 1)
+		: m_result(std::move(previous))
+		, m_fanout_gen(fanout_gen)
+		, m_nthreads(nthreads)
+		, m_net_of()
+		, m_workspace()
+	{
+		const auto& netlist = static_cast<const RouteAllResult<Netlist>&>(m_result).netlist();
+		for (const auto& root : netlist.roots()) {
+			netlist.for_all_descendants(root, 0, [&](const RouteElementID& id, int) {
+				m_net_of.emplace(id, root.asPin());
+				return 0;
+			});
+		}
+	}
+
+	IncrementalRouter(const IncrementalRouter&) = delete;
+	IncrementalRouter& operator=(const IncrementalRouter&) = delete;
+
+	/**
+	 * Update the routing for `delta`. pin_to_pin_netlist is the netlist after it (see apply_delta).
+	 * Afterwards, result().routeStats() are of the searches for this change only.
+	 */
+	void apply(const Netlist& pin_to_pin_netlist, const NetlistDelta& delta) {
+		m_result.routeStats() = {};
+
+		// rip up nets that lost connections, and forget that any of their connections were unrouted
+		std::vector<PinGID> ripped_up_nets;
+		std::unordered_set<PinGID> is_ripped_up;
+		for (const auto& source_and_sink : delta.removed) {
+			if (is_ripped_up.insert(source_and_sink.first).second) {
+				ripped_up_nets.push_back(source_and_sink.first);
+			}
+		}
+
+		std::vector<std::pair<PinGID, PinGID>> to_route;
+		for (const auto& src_pin : ripped_up_nets) {
+			rip_up(src_pin);
+
+			std::vector<PinGID> unrouted_sinks;
+			for (const auto& sink_pin : m_result.unroutedPins().fanout(src_pin)) {
+				unrouted_sinks.push_back(sink_pin);
+			}
+			for (const auto& sink_pin : unrouted_sinks) {
+				m_result.unroutedPins().removeConnection(src_pin, sink_pin);
+			}
+
+			for (const auto& sink_pin : pin_to_pin_netlist.fanout(src_pin)) {
+				to_route.emplace_back(src_pin, sink_pin);
+			}
+		}
+
+		for (const auto& source_and_sink : delta.added) {
+			if (is_ripped_up.find(source_and_sink.first) == end(is_ripped_up)) {
+				m_result.unroutedPins().removeConnection(source_and_sink.first, source_and_sink.second);
+				to_route.push_back(source_and_sink);
+			}
+		}
+
+		dout(DL::INFO) << "rerouting " << ripped_up_nets.size() << " nets, and " << to_route.size() << " connections in total\n";
+
+		for (const auto& source_and_sink : to_route) {
+			for (const auto& blocked_connection : route_connection(pin_to_pin_netlist, source_and_sink.first, source_and_sink.second, true)) {
+				route_connection(pin_to_pin_netlist, blocked_connection.first, blocked_connection.second, false);
+			}
+		}
+	}
+
+	const RouteAllResult<Netlist>& result() const { return m_result; }
+
+	/**
+	 * The source pin of the net using id, if any
+	 */
+	boost::optional<PinGID> netUsing(const RouteElementID& id) const {
+		const auto found = m_net_of.find(id);
+		if (found == end(m_net_of)) {
+			return boost::none;
+		} else {
+			return found->second;
+		}
+	}
+
+private:
+	// lets detail::add_route record which net is using what it adds
+	struct MarkUsedBy {
+		util::FlatHashMap<RouteElementID, PinGID>& net_of;
+		PinGID net;
+
+		void insert(const RouteElementID& id) { net_of.emplace(id, net); }
+	};
+
+	void rip_up(const PinGID& src_pin) {
+		const auto src_pin_re = RouteElementID(src_pin);
+		if (m_result.netlist().roots().find(src_pin_re) != end(m_result.netlist().roots())) {
+			for (const auto& id : m_result.netlist().removeTree(src_pin_re)) {
+				m_net_of.erase(id);
+			}
+		}
+	}
+
+	std::unordered_set<RouteElementID> routing_of_net(const PinGID& src_pin) const {
+		std::unordered_set<RouteElementID> routing;
+		m_result.netlist().for_all_descendants(RouteElementID(src_pin), 0, [&](const RouteElementID& id, int) {
+			routing.insert(id);
+			return 0;
+		});
+		return routing;
+	}
+
+	// returns the sources of the nets using any of route, other than this one
+	std::vector<PinGID> nets_using(const std::vector<RouteElementID>& route, const PinGID& src_pin) const {
+		std::vector<PinGID> nets;
+		util::FlatHashSet<PinGID> seen;
+		for (const auto& id : route) {
+			const auto owner = m_net_of.find(id);
+			if (owner != end(m_net_of) && owner->second != src_pin && seen.insert(owner->second).second) {
+				nets.push_back(owner->second);
+			}
+		}
+		return nets;
+	}
+
+	// returns the connections of any nets that had to be ripped up
+	std::vector<std::pair<PinGID, PinGID>> route_connection(const Netlist& pin_to_pin_netlist, const PinGID& src_pin, const PinGID& sink_pin, bool allow_rip_up) {
+		std::vector<std::pair<PinGID, PinGID>> to_reroute;
+
+		auto used_by_this_net = routing_of_net(src_pin);
+		if (used_by_this_net.find(RouteElementID(sink_pin)) != end(used_by_this_net)) {
+			return to_reroute; // already there
+		}
+
+		auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
+			str << "Routing " << src_pin << " -> " << sink_pin;
+		});
+
+		auto routed = detail::route_connection(src_pin, sink_pin, used_by_this_net, m_net_of, m_fanout_gen, m_nthreads, &m_result.routeStats(), m_workspace);
+
+		if (!routed && allow_rip_up) {
+			routed = detail::route_connection(src_pin, sink_pin, used_by_this_net, util::FlatHashSet<RouteElementID>(), m_fanout_gen, m_nthreads, &m_result.routeStats(), m_workspace);
+			if (routed) {
+				for (const auto& blocking_net : nets_using(m_workspace.path, src_pin)) {
+					const auto blocking_net_routing = routing_of_net(blocking_net);
+					for (const auto& sink : pin_to_pin_netlist.fanout(blocking_net)) {
+						if (blocking_net_routing.find(RouteElementID(sink)) != end(blocking_net_routing)) {
+							to_reroute.emplace_back(blocking_net, sink);
+						}
+					}
+					rip_up(blocking_net);
+				}
+				dout(DL::INFO) << "ripped up the routing of " << to_reroute.size() << " connections in the way\n";
+			}
+		}
+
+		if (routed) {
+			MarkUsedBy used{m_net_of, src_pin};
+			detail::add_route(m_workspace.path, m_result.netlist(), used_by_this_net, used);
+		} else {
+			m_result.unroutedPins().addConnection(src_pin, sink_pin);
+		}
+
+		return to_reroute;
+	}
+
+	RouteAllResult<Netlist> m_result;
+	const FanoutGenerator& m_fanout_gen;
+	int m_nthreads;
+	util::FlatHashMap<RouteElementID, PinGID> m_net_of; // the source pin of the net using each route element
+	MazeRouteWorkspace<RouteElementID> m_workspace;
+};
+
+} // end namespace algo
+
+#endif // ALGO__INCREMENTAL_ROUTING_H
@@ -1,10 +1,15 @@
 #ifndef ALGO__MAZE_ROUTER_H
 #define ALGO__MAZE_ROUTER_H
 
+#include <algo/route_stats.hpp>
 #include <graphics/graphics_types.hpp>
+#include <graphics/graphics_wrapper.hpp>
 #include <util/graph_algorithms.hpp>
 #include <util/logging.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <list>
 #include <unordered_map>
 #include <vector>
@@ -93,56 +98,158 @@ struct RouteTimeVisitor : public util::DefaultGraphVisitor<VertexID> {
 	void onDataEntryEnd()      { printRouteTimeSince( "data entry", data_entry_start); }
 };
 
+namespace detail {
+	/**
+	 * What a single maze_route search did. Only touched from the calling thread -
+	 * the wave's threads count into their own buffers, which are added in once per wave.
+	 */
+	struct SearchCounters {
+		std::size_t num_waves = 0;
+		std::size_t num_explored = 0;
+		std::size_t num_skipped = 0;
+		std::size_t num_fanouts_examined = 0;
+		std::chrono::steady_clock::time_point merge_start = {};
+		std::chrono::steady_clock::duration merge_time = std::chrono::steady_clock::duration::zero();
+
+		void addTo(MazeRouteStats& stats, const boost::optional<std::size_t>& traceback_length) const {
+			stats.num_searches += 1;
+			stats.num_failed_searches += traceback_length ? 0 : 1;
+			stats.num_waves += num_waves;
+			stats.num_explored += num_explored;
+			stats.num_skipped += num_skipped;
+			stats.num_fanouts_examined += num_fanouts_examined;
+			stats.traceback_length += traceback_length.value_or(0);
+			stats.merge_seconds += std::chrono::duration<double>(merge_time).count();
+			stats.waves_per_search.add(num_waves);
+			stats.explored_per_search.add(num_explored);
+			if (traceback_length) {
+				stats.traceback_length_per_search.add(*traceback_length);
+			}
+		}
+	};
+}
+
+/**
+ * Counts what the search does into `counters`, if there are any
+ */
 template<typename VertexID, typename OnWaveStart>
 struct Visitor : public RouteTimeVisitor<VertexID> {
-	Visitor(OnWaveStart&& ows) : onWaveStart(std::move(ows)) { }
-	Visitor(const OnWaveStart& ows) : onWaveStart(ows) { }
+	Visitor(OnWaveStart&& ows, detail::SearchCounters* counters) : onWaveStartImpl(std::move(ows)), counters(counters) { }
+	Visitor(const OnWaveStart& ows, detail::SearchCounters* counters) : onWaveStartImpl(ows), counters(counters) { }
+
+	Visitor(const Visitor&) = delete;
+	Visitor& operator=(const Visitor&) = delete;
 
-	OnWaveStart onWaveStart;
+	OnWaveStart onWaveStartImpl;
+	detail::SearchCounters* counters;
+
+	template<typename VertexCollection>
+	void onWaveStart(const VertexCollection& wave) {
+		if (counters) {
+			counters->num_waves += 1;
+			counters->num_explored += wave.size();
+		}
+		onWaveStartImpl(wave);
+	}
+
+	void onWaveCounts(const util::WaveCounts& wave_counts) {
+		if (counters) {
+			counters->num_skipped += wave_counts.num_skipped_explores;
+			counters->num_fanouts_examined += wave_counts.num_fanouts + wave_counts.num_skipped_fanouts;
+		}
+	}
+
+	void onNextWaveCalcStart() {
+		RouteTimeVisitor<VertexID>::onNextWaveCalcStart();
+		if (counters) { counters->merge_start = std::chrono::steady_clock::now(); }
+	}
 
-	void onExplore(VertexID id) {
-		dout(DL::ROUTE_D1) << "visit: " << id << '\n';
+	void onNextWaveCalcEnd() {
+		RouteTimeVisitor<VertexID>::onNextWaveCalcEnd();
+		if (counters) { counters->merge_time += std::chrono::steady_clock::now() - counters->merge_start; }
 	}
 };
 
+/**
+ * What maze_route can keep from one search to the next, so that routing connection after
+ * connection doesn't allocate for each one. Only one search may use it at a time.
+ */
+template<typename ID>
+struct MazeRouteWorkspace {
+	util::SearchWorkspace<ID> search = {};
+	std::vector<ID> path = {}; // for the route found
+};
+
+/**
+ * Finds a path from one of sources to sink, and puts it in `path` (source first).
+ * Returns false, leaving path empty, if there isn't one -- including when sink or
+ * one of sources isn't in fanout_gen's graph at all.
+ * With a workspace, once it has grown big enough, the search doesn't allocate.
+ */
 template<typename ID, typename IDSet, typename ID2, typename FanoutGenerator, typename ShouldIgnore>
-boost::optional<std::vector<ID>> maze_route(IDSet&& sources, ID2&& sink, FanoutGenerator&& fanout_gen, ShouldIgnore&& should_ignore, int nthreads = 1) {
+bool maze_route_into(std::vector<ID>& path, IDSet&& sources, ID2&& sink, FanoutGenerator&& fanout_gen, ShouldIgnore&& should_ignore, int nthreads = 1, MazeRouteStats* stats = nullptr, util::SearchWorkspace<ID>* workspace = nullptr) {
+	path.clear();
+
+	const auto is_vertex = [&](const auto& id) { return util::detail::contains_vertex(fanout_gen, id, util::detail::Preference<1>()); };
+	if (!is_vertex(sink) || !std::all_of(begin(sources), end(sources), is_vertex)) {
+		dout(DL::WARN) << "can't route to " << sink << ": it or a source isn't in the graph\n";
+		if (stats) {
+			detail::SearchCounters().addTo(*stats, boost::none);
+		}
+		return false;
+	}
 
 	const auto onWaveStart = [&](const auto& wave) {
-		detail::displayWavefront<ID>(sources, sink, fanout_gen, std::vector<ID>(), std::vector<ID>(), wave);
+		if (graphics::compiled_in) {
+			detail::displayWavefront<ID>(sources, sink, fanout_gen, std::vector<ID>(), std::vector<ID>(), wave);
+		}
 	};
 
+	detail::SearchCounters counters;
+	Visitor<ID, decltype(onWaveStart)> visitor(onWaveStart, stats ? &counters : nullptr);
+
 	auto is_sink = [&](auto& v) { return v == sink; };
-	const auto data2 = util::GraphAlgo<ID>().withThreads(nthreads).wavedBreadthFirstVisit(fanout_gen, sources, is_sink, Visitor<ID, decltype(onWaveStart)>(onWaveStart), should_ignore);
+	const auto data2 = util::GraphAlgo<ID>().withThreads(nthreads).wavedBreadthFirstVisit(fanout_gen, sources, is_sink, visitor, should_ignore, workspace);
 
 	dout(DL::ROUTE_D1) << "tracing2back... ";
 
-	boost::optional<std::vector<ID>> reversed_result = std::vector<ID>();
+	bool found = true;
 	auto traceback_curr = sink;
 	while (true) {
-		reversed_result->push_back(traceback_curr);
+		path.push_back(traceback_curr);
 		if (sources.find(traceback_curr) != end(sources)) {
 			dout(DL::ROUTE_D1) << traceback_curr << '\n';
 			break;
 		} else {
-			const auto& found_data = data2.find(traceback_curr);
-			if (found_data == end(data2) || found_data->second.fanin.empty()) {
+			const auto parent = data2.parent(traceback_curr);
+			if (!parent) {
 				dout(DL::ROUTE_D1) << "couldn't trace back past " << traceback_curr << '\n';
-				reversed_result = boost::none;
+				found = false;
 				break;
 			} else {
 				dout(DL::ROUTE_D1) << traceback_curr << " -> ";
-				traceback_curr = found_data->second.fanin.front();
+				traceback_curr = *parent;
 			}
 		}
 	}
 
-	if (reversed_result) {
-		std::vector<ID> result;
-		for (auto it = reversed_result->rbegin(); it != reversed_result->rend(); ++it) {
-			result.push_back(*it);
-		}
-		return result;
+	if (stats) {
+		counters.addTo(*stats, found ? boost::make_optional(path.size()) : boost::none);
+	}
+
+	if (found) {
+		std::reverse(begin(path), end(path));
+	} else {
+		path.clear();
+	}
+	return found;
+}
+
+template<typename ID, typename IDSet, typename ID2, typename FanoutGenerator, typename ShouldIgnore>
+boost::optional<std::vector<ID>> maze_route(IDSet&& sources, ID2&& sink, FanoutGenerator&& fanout_gen, ShouldIgnore&& should_ignore, int nthreads = 1, MazeRouteStats* stats = nullptr) {
+	std::vector<ID> path;
+	if (maze_route_into<ID>(path, sources, sink, fanout_gen, should_ignore, nthreads, stats)) {
+		return path;
 	} else {
 		return boost::none;
 	}
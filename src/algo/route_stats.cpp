@@ -0,0 +1,84 @@
+#include "route_stats.hpp"
+
+#include <ostream>
+
+namespace algo {
+
+const std::size_t Log2Histogram::NUM_BUCKETS;
+
+MazeRouteStats& MazeRouteStats::operator+=(const MazeRouteStats& rhs) {
+	num_searches += rhs.num_searches;
+	num_failed_searches += rhs.num_failed_searches;
+	num_waves += rhs.num_waves;
+	num_explored += rhs.num_explored;
+	num_skipped += rhs.num_skipped;
+	num_fanouts_examined += rhs.num_fanouts_examined;
+	traceback_length += rhs.traceback_length;
+	merge_seconds += rhs.merge_seconds;
+	waves_per_search += rhs.waves_per_search;
+	explored_per_search += rhs.explored_per_search;
+	traceback_length_per_search += rhs.traceback_length_per_search;
+	return *this;
+}
+
+namespace {
+	template<typename F>
+	void for_each_total(const MazeRouteStats& stats, F&& f) {
+		f("num_searches", stats.num_searches);
+		f("num_failed_searches", stats.num_failed_searches);
+		f("num_waves", stats.num_waves);
+		f("num_explored", stats.num_explored);
+		f("num_skipped", stats.num_skipped);
+		f("num_fanouts_examined", stats.num_fanouts_examined);
+		f("traceback_length", stats.traceback_length);
+		f("merge_seconds", stats.merge_seconds);
+	}
+
+	template<typename F>
+	void for_each_histogram(const MazeRouteStats& stats, F&& f) {
+		f("waves_per_search", stats.waves_per_search);
+		f("explored_per_search", stats.explored_per_search);
+		f("traceback_length_per_search", stats.traceback_length_per_search);
+	}
+}
+
+void write_json(std::ostream& os, const MazeRouteStats& stats) {
+	os << '{';
+	bool first = true;
+	for_each_total(stats, [&](const char* name, const auto& value) {
+		os << (first ? "" : ",") << '"' << name << "\":" << value;
+		first = false;
+	});
+	for_each_histogram(stats, [&](const char* name, const Log2Histogram& histogram) {
+		os << ",\"" << name << "\":[";
+		bool first_bucket = true;
+		for (std::size_t ibucket = 0; ibucket < Log2Histogram::NUM_BUCKETS; ++ibucket) {
+			if (histogram.count(ibucket) == 0) {
+				continue;
+			}
+			os << (first_bucket ? "" : ",")
+				<< "{\"min\":" << Log2Histogram::bucketMin(ibucket)
+				<< ",\"max\":" << Log2Histogram::bucketMax(ibucket)
+				<< ",\"count\":" << histogram.count(ibucket) << '}';
+			first_bucket = false;
+		}
+		os << ']';
+	});
+	os << "}\n";
+}
+
+void write_csv(std::ostream& os, const MazeRouteStats& stats) {
+	os << "metric,bucket_min,bucket_max,value\n";
+	for_each_total(stats, [&](const char* name, const auto& value) {
+		os << name << ",,," << value << '\n';
+	});
+	for_each_histogram(stats, [&](const char* name, const Log2Histogram& histogram) {
+		for (std::size_t ibucket = 0; ibucket < Log2Histogram::NUM_BUCKETS; ++ibucket) {
+			if (histogram.count(ibucket) != 0) {
+				os << name << ',' << Log2Histogram::bucketMin(ibucket) << ',' << Log2Histogram::bucketMax(ibucket) << ',' << histogram.count(ibucket) << '\n';
+			}
+		}
+	});
+}
+
+} // end namespace algo
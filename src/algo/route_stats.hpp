@@ -0,0 +1,77 @@
+#ifndef ALGO__ROUTE_STATS_H
+#define ALGO__ROUTE_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+
+namespace algo {
+
+/**
+ * Counts of values in power-of-two buckets: bucket 0 holds 0, bucket 1 holds 1,
+ * bucket 2 holds 2..3, bucket 3 holds 4..7, and so on.
+ */
+class Log2Histogram {
+public:
+	static const std::size_t NUM_BUCKETS = 8*sizeof(std::size_t) + 1;
+
+	void add(std::size_t value) {
+		std::size_t ibucket = 0;
+		while (value != 0) {
+			value >>= 1;
+			ibucket += 1;
+		}
+		buckets[ibucket] += 1;
+	}
+
+	Log2Histogram& operator+=(const Log2Histogram& rhs) {
+		for (std::size_t ibucket = 0; ibucket < NUM_BUCKETS; ++ibucket) {
+			buckets[ibucket] += rhs.buckets[ibucket];
+		}
+		return *this;
+	}
+
+	std::size_t count(std::size_t ibucket) const { return buckets[ibucket]; }
+	static std::size_t bucketMin(std::size_t ibucket) { return ibucket == 0 ? 0 : std::size_t(1) << (ibucket - 1); }
+	static std::size_t bucketMax(std::size_t ibucket) { return ibucket == 0 ? 0 : bucketMin(ibucket) + (bucketMin(ibucket) - 1); }
+
+private:
+	std::array<std::size_t, NUM_BUCKETS> buckets = std::array<std::size_t, NUM_BUCKETS>();
+};
+
+/**
+ * Counts of the work done by calls to maze_route. Totals over all searches,
+ * and the distributions of some of them per search (ie. per connection).
+ */
+struct MazeRouteStats {
+	std::size_t num_searches = 0;
+	std::size_t num_failed_searches = 0;
+	std::size_t num_waves = 0;
+	std::size_t num_explored = 0; // everything taken out of a wave, including the skipped
+	std::size_t num_skipped = 0; // taken out of a wave, but ignored
+	std::size_t num_fanouts_examined = 0;
+	std::size_t traceback_length = 0; // of the successful searches
+	double merge_seconds = 0; // merging each thread's part of the next wave
+
+	Log2Histogram waves_per_search = {};
+	Log2Histogram explored_per_search = {};
+	Log2Histogram traceback_length_per_search = {};
+
+	MazeRouteStats& operator+=(const MazeRouteStats& rhs);
+};
+
+/**
+ * One JSON object, with a member for each total, and one for each histogram
+ * holding an array of its non-empty buckets.
+ */
+void write_json(std::ostream& os, const MazeRouteStats& stats);
+
+/**
+ * Rows of metric,bucket_min,bucket_max,value - the totals have empty bucket
+ * columns, and each non-empty histogram bucket gets a row.
+ */
+void write_csv(std::ostream& os, const MazeRouteStats& stats);
+
+} // end namespace algo
+
+#endif // ALGO__ROUTE_STATS_H
@@ -0,0 +1,196 @@
+#ifndef ALGO__ROUTE_VERIFIER_H
+#define ALGO__ROUTE_VERIFIER_H
+
+#include <algo/routing.hpp>
+#include <device/device.hpp>
+#include <util/flat_hash.hpp>
+#include <util/frozen_netlist.hpp>
+#include <util/graph_algorithms.hpp>
+#include <util/netlist.hpp>
+#include <util/print_printable.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace algo {
+
+/**
+ * Something wrong with a routing, found by verify_routing
+ */
+struct RoutingViolation : public util::print_printable {
+	enum class Type {
+		UnconnectedSink, // `net` was supposed to reach `to`, but doesn't
+		IllegalEdge,     // `where` -> `to` is used, but isn't in the device's fanout of `where`
+		OtherNetsPin,    // `where` -> `to` is used, but `to` is a pin that isn't part of `net`
+		Short,           // `where` is used by both `net` and `other_net`
+		NotInAnyNet,     // there's routing from `where` that doesn't start at any net's source
+	};
+
+	RoutingViolation(Type type, device::PinGID net, device::RouteElementID where, boost::optional<device::RouteElementID> to = boost::none, boost::optional<device::PinGID> other_net = boost::none)
+		: type(type)
+		, net(net)
+		, where(where)
+		, to(to)
+		, other_net(other_net)
+	{ }
+
+	Type type;
+	device::PinGID net;
+	device::RouteElementID where;
+	boost::optional<device::RouteElementID> to;
+	boost::optional<device::PinGID> other_net;
+
+	template<typename STREAM>
+	void print(STREAM& os) const {
+		switch (type) {
+			case Type::UnconnectedSink: os << "net " << net << " doesn't reach its sink " << *to; break;
+			case Type::IllegalEdge:     os << "net " << net << " uses " << where << " -> " << *to << ", which isn't in the device"; break;
+			case Type::OtherNetsPin:    os << "net " << net << " uses " << where << " -> " << *to << ", which is another net's pin"; break;
+			case Type::Short:           os << "nets " << net << " and " << *other_net << " are shorted at " << where; break;
+			case Type::NotInAnyNet:     os << "routing from " << where << " isn't part of any net"; break;
+		}
+	}
+};
+
+/**
+ * Checks a routing against the device and the connections it was supposed to make:
+ * that every edge used is in the device's fanout, that each net only touches its
+ * own pins, that no routing resource is used by two nets, and that every sink that
+ * isn't in result.unroutedPins() is reached from its source. A net is the tree in
+ * result.netlist() rooted at the RouteElementID of its source pin.
+ *
+ * Nets are checked on nThreads threads. Returns all violations found, in a
+ * consistent order. Nothing found means the routing is legal.
+ */
+template<typename UnroutedNetlist, typename Device>
+std::vector<RoutingViolation> verify_routing(
+	const RouteAllResult<UnroutedNetlist>& result,
+	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
+	const Device& dev,
+	int nThreads = 1
+) {
+	using device::PinGID;
+	using device::RouteElementID;
+
+	const std::vector<PinGID> nets(begin(pin_to_pin_netlist.roots()), end(pin_to_pin_netlist.roots()));
+	const util::FrozenNetlist<RouteElementID> routing(result.netlist()); // read by every thread
+
+	const auto is_in_device_fanout = [&](const RouteElementID& from, const RouteElementID& to) {
+		for (const auto& fanout : util::fanout_of(dev, from)) {
+			if (fanout == to) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	struct ThreadResults {
+		std::vector<std::pair<std::size_t, RoutingViolation>> violations = {}; // with the index of the net
+		std::vector<std::pair<RouteElementID::IDType, std::size_t>> used_by = {}; // (RE, index of the net)
+	};
+	std::vector<ThreadResults> thread_results(static_cast<std::size_t>(std::max(1, nThreads)));
+
+	std::atomic<std::size_t> next_net(0);
+	const auto check_nets = [&](ThreadResults& out) {
+		util::FlatHashSet<RouteElementID> in_this_net;
+		util::FlatHashSet<PinGID> sinks;
+
+		while (true) {
+			const auto inet = next_net.fetch_add(1);
+			if (inet >= nets.size()) {
+				return;
+			}
+			const auto& source = nets[inet];
+			const auto source_re = RouteElementID(source);
+
+			in_this_net.clear();
+			sinks.clear();
+			for (const auto& sink : pin_to_pin_netlist.fanout(source)) {
+				sinks.insert(sink);
+			}
+
+			routing.for_all_descendants(source_re, source_re, [&](const RouteElementID& curr, const RouteElementID& parent) {
+				out.used_by.emplace_back(curr.getValue(), inet);
+				in_this_net.insert(curr);
+				if (curr == source_re) {
+					return curr;
+				}
+
+				if (!is_in_device_fanout(parent, curr)) {
+					out.violations.emplace_back(inet, RoutingViolation(RoutingViolation::Type::IllegalEdge, source, parent, curr));
+				}
+				if (curr.isPin() && sinks.find(curr.asPin()) == end(sinks)) {
+					out.violations.emplace_back(inet, RoutingViolation(RoutingViolation::Type::OtherNetsPin, source, parent, curr));
+				}
+				return curr;
+			});
+
+			for (const auto& sink : pin_to_pin_netlist.fanout(source)) {
+				const auto sink_re = RouteElementID(sink);
+				if (in_this_net.find(sink_re) != end(in_this_net)) {
+					continue;
+				}
+				bool is_known_unrouted = false;
+				for (const auto& unrouted_sink : result.unroutedPins().fanout(source)) {
+					is_known_unrouted |= unrouted_sink == sink;
+				}
+				if (!is_known_unrouted) {
+					out.violations.emplace_back(inet, RoutingViolation(RoutingViolation::Type::UnconnectedSink, source, source_re, sink_re));
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (auto& out : thread_results) {
+		threads.emplace_back(check_nets, std::ref(out));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	std::vector<std::pair<std::size_t, RoutingViolation>> per_net_violations;
+	std::vector<std::pair<RouteElementID::IDType, std::size_t>> used_by;
+	for (auto& out : thread_results) {
+		per_net_violations.insert(end(per_net_violations), begin(out.violations), end(out.violations));
+		used_by.insert(end(used_by), begin(out.used_by), end(out.used_by));
+	}
+
+	std::stable_sort(begin(per_net_violations), end(per_net_violations), [](const auto& lhs, const auto& rhs) {
+		return lhs.first < rhs.first;
+	});
+	std::vector<RoutingViolation> violations;
+	for (const auto& inet_and_violation : per_net_violations) {
+		violations.push_back(inet_and_violation.second);
+	}
+
+	// anything used by more than one net is a short
+	std::sort(begin(used_by), end(used_by));
+	for (auto it = begin(used_by); it != end(used_by); ++it) {
+		const auto next = std::next(it);
+		if (next != end(used_by) && next->first == it->first && next->second != it->second) {
+			violations.emplace_back(RoutingViolation::Type::Short, nets[it->second], util::make_id<RouteElementID>(it->first), boost::none, nets[next->second]);
+		}
+	}
+
+	// and any routing that no net reached must be hanging off something else
+	for (const auto& root : routing.roots()) {
+		if (!root.isPin() || pin_to_pin_netlist.roots().find(root.asPin()) == end(pin_to_pin_netlist.roots())) {
+			violations.emplace_back(RoutingViolation::Type::NotInAnyNet, PinGID(), root);
+		}
+	}
+
+	return violations;
+}
+
+} // end namespace algo
+
+#endif // ALGO__ROUTE_VERIFIER_H
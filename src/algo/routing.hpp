@@ -5,30 +5,99 @@
 #include <device/connectors.hpp>
 #include <device/device.hpp>
 #include <graphics/graphics_wrapper_fpga.hpp>
+#include <util/flat_hash.hpp>
 #include <util/logging.hpp>
 
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
 #include <boost/optional.hpp>
 
 namespace algo {
 
+/**
+ * The routing is held in a shared, copy-on-write netlist, so that it can be handed to
+ * graphics (or copied along with the result) without copying it. A reference from the
+ * non-const netlist() shouldn't be kept across taking a netlistSnapshot().
+ */
 template<typename UnroutedNetlist>
 class RouteAllResult {
 	using ResultNetlist = util::Netlist<device::RouteElementID, true>;
 public:
-	auto& netlist() const { return m_netlist; }
-	auto& netlist()       { return m_netlist; }
+	const ResultNetlist& netlist() const { return *m_netlist; }
+	ResultNetlist& netlist() {
+		if (m_netlist.use_count() > 1) {
+			m_netlist = std::make_shared<ResultNetlist>(*m_netlist); // someone has a snapshot
+		}
+		return *m_netlist;
+	}
+
+	/**
+	 * The routing as it is now, which doesn't change if this does.
+	 */
+	std::shared_ptr<const ResultNetlist> netlistSnapshot() const { return m_netlist; }
 
 	auto& unroutedPins() const { return m_unroutedPins; }
 	auto& unroutedPins()       { return m_unroutedPins; }
+
+	auto& routeStats() const { return m_routeStats; }
+	auto& routeStats()       { return m_routeStats; }
 private:
-	ResultNetlist m_netlist = {};
+	std::shared_ptr<ResultNetlist> m_netlist = std::make_shared<ResultNetlist>();
 	UnroutedNetlist m_unroutedPins = {};
+	MazeRouteStats m_routeStats = {};
 };
 
+namespace detail {
+	/**
+	 * Route src_pin -> sink_pin, starting from anything already in this net, and
+	 * not using anything used by other nets, or any pin that isn't src_pin or sink_pin.
+	 * The route is left in workspace.path. Returns false if there isn't one.
+	 */
+	template<typename UsedSet, typename FanoutGenerator>
+	bool route_connection(
+		const device::PinGID& src_pin,
+		const device::PinGID& sink_pin,
+		const std::unordered_set<device::RouteElementID>& used_by_this_net,
+		const UsedSet& used,
+		FanoutGenerator&& fanout_gen,
+		int nthreads,
+		MazeRouteStats* stats,
+		MazeRouteWorkspace<device::RouteElementID>& workspace
+	) {
+		return algo::maze_route_into<device::RouteElementID>(workspace.path, used_by_this_net, device::RouteElementID(sink_pin), fanout_gen, [&](auto&& reid) {
+			return (reid != sink_pin && reid != src_pin && reid.isPin()) || (used.find(reid) != end(used) && used_by_this_net.find(reid) == end(used_by_this_net));
+		}, nthreads, stats, &workspace.search);
+	}
+
+	/**
+	 * Add a route found by route_connection to the result, and mark it as used
+	 */
+	template<typename ResultNetlist, typename UsedSet>
+	void add_route(
+		const std::vector<device::RouteElementID>& route,
+		ResultNetlist& result_netlist,
+		std::unordered_set<device::RouteElementID>& used_by_this_net,
+		UsedSet& used
+	) {
+		boost::optional<device::RouteElementID> prev;
+		for (const auto& id : route) {
+			used.insert(id);
+			used_by_this_net.insert(id);
+			if (prev) {
+				result_netlist.addConnection(*prev, id);
+			}
+			prev = id;
+		}
+	}
+}
+
 template<bool exitAtFirstNoRoute, typename Netlist, typename NetOrder, typename FanoutGenerator>
 RouteAllResult<Netlist> route_all(const Netlist& pin_to_pin_netlist, NetOrder&& net_order, FanoutGenerator&& fanout_gen, int ntheads = 1) {
 	RouteAllResult<Netlist> result;
-	std::unordered_set<device::RouteElementID> used;
+	util::FlatHashSet<device::RouteElementID> used;
+	MazeRouteWorkspace<device::RouteElementID> workspace;
 
 	const auto gfx_state_keeper = graphics::get().fpga().pushRoutingState(&fanout_gen, true);
 	bool encountered_failing_pin = false;
@@ -50,23 +119,14 @@ RouteAllResult<Netlist> route_all(const Netlist& pin_to_pin_netlist, NetOrder&&
 				str << "Routing " << src_pin_re << " -> " << sink_pin_re;
 			});
 
-			const auto& new_routing = algo::maze_route<device::RouteElementID>(used_by_this_net, sink_pin_re, fanout_gen, [&](auto&& reid) {
-				return (reid != sink_pin && reid != src_pin && reid.isPin()) || (used.find(reid) != end(used) && used_by_this_net.find(reid) == end(used_by_this_net));
-			}, ntheads);
-
-			if (new_routing) {
-				boost::optional<device::RouteElementID> prev;
-				for (const auto& id : *new_routing) {
-					used.insert(id);
-					used_by_this_net.insert(id);
-					if (prev) {
-						result.netlist().addConnection(*prev, id);
-					}
-					prev = id;
-				}
+			if (detail::route_connection(src_pin, sink_pin, used_by_this_net, used, fanout_gen, ntheads, &result.routeStats(), workspace)) {
+				detail::add_route(workspace.path, result.netlist(), used_by_this_net, used);
 
 				if (dout(DL::PIN_BY_PIN_STEP).enabled()) {
-					const auto gfx_state_keeper = graphics::get().fpga().pushRoutingState(&fanout_gen, {*new_routing}, true);
+					// the next search refills workspace.path anyway, so it can be given away
+					auto path_snapshot = graphics::detail::make_snapshot(graphics::FPGAGraphicsData::Paths{std::move(workspace.path)});
+					workspace.path.clear();
+					const auto gfx_state_keeper = graphics::get().fpga().pushRoutingState(&fanout_gen, std::move(path_snapshot), nullptr, nullptr, true);
 					graphics::get().waitForPress();
 				}
 			} else {
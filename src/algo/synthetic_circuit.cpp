@@ -0,0 +1,234 @@
+#include "synthetic_circuit.hpp"
+
+#include <util/logging.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include <boost/optional.hpp>
+
+namespace algo {
+
+namespace {
+	const int PINS_PER_BLOCK = 4; // one per side
+
+	class Random {
+	public:
+		explicit Random(std::uint64_t seed) : engine(seed) { }
+
+		/**
+		 * Uniform in [0, n). Rejects the top partial range, so there's no modulo bias.
+		 */
+		std::uint64_t below(std::uint64_t n) {
+			const auto limit = std::numeric_limits<std::uint64_t>::max() - std::numeric_limits<std::uint64_t>::max() % n;
+			while (true) {
+				const auto x = engine();
+				if (x < limit) {
+					return x % n;
+				}
+			}
+		}
+
+		/**
+		 * Uniform in [0, 1)
+		 */
+		double unit() {
+			return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0);
+		}
+
+		bool coin() { return (engine() >> 63) != 0; }
+
+	private:
+		std::mt19937_64 engine;
+	};
+
+	/**
+	 * Draws connection lengths 1..max_length, by binary search of the cumulative weights
+	 */
+	class LengthDistribution {
+	public:
+		LengthDistribution(int max_length, double rent_exponent)
+			: cumulative_weights()
+		{
+			double total = 0;
+			for (int length = 1; length <= max_length; ++length) {
+				total += std::pow(static_cast<double>(length), 2*rent_exponent - 3);
+				cumulative_weights.push_back(total);
+			}
+		}
+
+		int draw(Random& random) const {
+			const auto target = random.unit() * cumulative_weights.back();
+			const auto found = std::upper_bound(begin(cumulative_weights), end(cumulative_weights), target);
+			return 1 + static_cast<int>(std::min<std::ptrdiff_t>(
+				std::distance(begin(cumulative_weights), found),
+				static_cast<std::ptrdiff_t>(cumulative_weights.size()) - 1
+			));
+		}
+
+	private:
+		std::vector<double> cumulative_weights;
+	};
+
+	class PinAllocator {
+	public:
+		explicit PinAllocator(int grid_size)
+			: grid_size(grid_size)
+			, num_free(static_cast<std::size_t>(grid_size)*static_cast<std::size_t>(grid_size)*PINS_PER_BLOCK)
+			, used(num_free, false)
+		{ }
+
+		std::size_t numFree() const { return num_free; }
+
+		bool hasFreePin(int x, int y) const {
+			for (int pin = 0; pin < PINS_PER_BLOCK; ++pin) {
+				if (!used[index(x, y, pin)]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * Takes a random free pin of the block. There must be one.
+		 */
+		device::PinGID take(int x, int y, Random& random) {
+			int num_free_here = 0;
+			for (int pin = 0; pin < PINS_PER_BLOCK; ++pin) {
+				num_free_here += used[index(x, y, pin)] ? 0 : 1;
+			}
+
+			auto nth_free = random.below(static_cast<std::uint64_t>(num_free_here));
+			for (int pin = 0; pin < PINS_PER_BLOCK; ++pin) {
+				if (!used[index(x, y, pin)] && nth_free-- == 0) {
+					used[index(x, y, pin)] = true;
+					num_free -= 1;
+					return device::PinGID(
+						device::BlockID(util::make_id<device::XID>(static_cast<device::XID::IDType>(x)), util::make_id<device::YID>(static_cast<device::YID::IDType>(y))),
+						util::make_id<device::BlockPinID>(static_cast<device::BlockPinID::IDType>(pin + 1))
+					);
+				}
+			}
+			throw std::logic_error("no free pin on block");
+		}
+
+		/**
+		 * A uniformly random block with a free pin. Only call if numFree() != 0.
+		 */
+		std::pair<int, int> anyBlockWithAFreePin(Random& random) const {
+			while (true) {
+				const auto x = static_cast<int>(random.below(static_cast<std::uint64_t>(grid_size)));
+				const auto y = static_cast<int>(random.below(static_cast<std::uint64_t>(grid_size)));
+				if (hasFreePin(x, y)) {
+					return {x, y};
+				}
+			}
+		}
+
+	private:
+		std::size_t index(int x, int y, int pin) const {
+			return (static_cast<std::size_t>(y)*static_cast<std::size_t>(grid_size) + static_cast<std::size_t>(x))*PINS_PER_BLOCK + static_cast<std::size_t>(pin);
+		}
+
+		int grid_size;
+		std::size_t num_free;
+		std::vector<bool> used;
+	};
+}
+
+SyntheticCircuit make_synthetic_circuit(const SyntheticCircuitParams& params) {
+	if (params.grid_size < 2 || params.grid_size > std::numeric_limits<device::XID::IDType>::max()) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "grid size must be at least 2, and fit in a coordinate, not " << params.grid_size;
+		});
+	}
+	if (params.track_width < 1) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "track width must be positive, not " << params.track_width;
+		});
+	}
+	if (!(params.rent_exponent > 0 && params.rent_exponent < 1)) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "Rent's exponent must be between 0 and 1, not " << params.rent_exponent;
+		});
+	}
+	if (!(params.mean_fanout >= 1)) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "mean fanout must be at least 1, not " << params.mean_fanout;
+		});
+	}
+
+	const auto num_pins = static_cast<std::size_t>(params.grid_size)*static_cast<std::size_t>(params.grid_size)*PINS_PER_BLOCK;
+	const auto expected_pins_needed = static_cast<std::size_t>(static_cast<double>(params.num_connections) * (1 + 1/params.mean_fanout));
+	if (expected_pins_needed > num_pins) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << params.num_connections << " connections with a mean fanout of " << params.mean_fanout
+				<< " need about " << expected_pins_needed << " pins, but a " << params.grid_size << 'x' << params.grid_size
+				<< " grid only has " << num_pins;
+		});
+	}
+
+	SyntheticCircuit result{
+		device::DeviceInfo{
+			device::DeviceTypeID(),
+			geom::BoundBox<int>(0, 0, params.grid_size - 1, params.grid_size - 1),
+			params.track_width,
+			1,
+			2,
+		},
+		{},
+	};
+	result.connections.reserve(params.num_connections);
+
+	Random random(params.seed);
+	const LengthDistribution lengths(2*(params.grid_size - 1), params.rent_exponent);
+	PinAllocator pins(params.grid_size);
+	const auto is_on_grid = [&](int x, int y) {
+		return 0 <= x && x < params.grid_size && 0 <= y && y < params.grid_size;
+	};
+
+	while (result.connections.size() < params.num_connections) {
+		if (pins.numFree() < 2) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+				str << "ran out of pins after " << result.connections.size() << " connections - try a bigger grid, or a higher fanout";
+			});
+		}
+
+		const auto source_block = pins.anyBlockWithAFreePin(random);
+		const auto source = pins.take(source_block.first, source_block.second, random);
+
+		// 1 + geometric, so the mean is mean_fanout
+		std::size_t fanout = 1;
+		while (random.unit() >= 1/params.mean_fanout) {
+			fanout += 1;
+		}
+		fanout = std::min({fanout, params.num_connections - result.connections.size(), pins.numFree()});
+
+		for (std::size_t isink = 0; isink < fanout; ++isink) {
+			// somewhere on the ring at a random distance, or anywhere if that keeps missing
+			boost::optional<std::pair<int, int>> sink_block;
+			for (int attempt = 0; attempt < 64 && !sink_block; ++attempt) {
+				const auto length = lengths.draw(random);
+				const auto dx = static_cast<int>(random.below(static_cast<std::uint64_t>(2*length + 1))) - length;
+				const auto dy = (length - std::abs(dx)) * (random.coin() ? 1 : -1);
+				const auto x = source_block.first + dx;
+				const auto y = source_block.second + dy;
+				if (is_on_grid(x, y) && pins.hasFreePin(x, y)) {
+					sink_block = std::make_pair(x, y);
+				}
+			}
+			if (!sink_block) {
+				sink_block = pins.anyBlockWithAFreePin(random);
+			}
+
+			result.connections.emplace_back(source, pins.take(sink_block->first, sink_block->second, random));
+		}
+	}
+
+	return result;
+}
+
+} // end namespace algo
@@ -0,0 +1,47 @@
+#ifndef ALGO__SYNTHETIC_CIRCUIT_H
+#define ALGO__SYNTHETIC_CIRCUIT_H
+
+#include <device/device.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace algo {
+
+struct SyntheticCircuitParams {
+	int grid_size = 10;
+	int track_width = 10;
+	std::size_t num_connections = 100;
+
+	// Rent's exponent of the circuit - lower means more local connections.
+	// Connection lengths (Manhattan distance) are drawn with probability proportional
+	// to length^(2*rent_exponent - 3), after Donath's wire length distribution.
+	double rent_exponent = 0.65;
+
+	// the mean number of sinks in each net (geometrically distributed, at least 1)
+	double mean_fanout = 3.0;
+
+	std::uint64_t seed = 1;
+};
+
+struct SyntheticCircuit {
+	device::DeviceInfo device_info;
+	std::vector<std::pair<device::PinGID, device::PinGID>> connections; // grouped by net
+};
+
+/**
+ * Makes a random routing problem with the given shape. The same params always
+ * give the same circuit - all randomness comes from a std::mt19937_64 seeded
+ * with params.seed, and doesn't go through the (implementation defined)
+ * standard distributions.
+ *
+ * Every pin is used at most once, as a source or a sink, so each block's 4 pins
+ * limit the size. Throws std::invalid_argument if the params can't fit.
+ */
+SyntheticCircuit make_synthetic_circuit(const SyntheticCircuitParams& params);
+
+} // end namespace algo
+
+#endif // ALGO__SYNTHETIC_CIRCUIT_H
@@ -0,0 +1,193 @@
+#include "../incremental_routing.hpp"
+#include "../route_verifier.hpp"
+#include "../routing.hpp"
+
+#include <device/connectors.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using device::PinGID;
+using device::RouteElementID;
+
+using TestDevice = device::Device<device::FullyConnectedConnector>;
+using PinNetlist = util::Netlist<PinGID>;
+
+namespace {
+
+TestDevice make_test_device(int track_width) {
+	return TestDevice(device::DeviceInfo{device::DeviceType::FullyConnected, geom::BoundBox<int>(0,0,4,4), track_width, 1, 2});
+}
+
+PinGID pin(std::int16_t x, std::int16_t y, std::int16_t block_pin) {
+	return util::make_id<PinGID>(
+		util::make_id<device::BlockID>(util::make_id<device::XID>(x), util::make_id<device::YID>(y)),
+		util::make_id<device::BlockPinID>(block_pin)
+	);
+}
+
+algo::RouteAllResult<PinNetlist> route_from_scratch(const PinNetlist& pin_to_pin_netlist, const TestDevice& dev) {
+	const std::vector<PinGID> net_order(begin(pin_to_pin_netlist.roots()), end(pin_to_pin_netlist.roots()));
+	return algo::route_all<false>(pin_to_pin_netlist, net_order, dev);
+}
+
+std::unordered_set<RouteElementID> routing_of_net(const algo::RouteAllResult<PinNetlist>& result, const PinGID& src_pin) {
+	std::unordered_set<RouteElementID> routing;
+	if (result.netlist().roots().find(RouteElementID(src_pin)) != end(result.netlist().roots())) {
+		result.netlist().for_all_descendants(RouteElementID(src_pin), 0, [&](const RouteElementID& id, int) {
+			routing.insert(id);
+			return 0;
+		});
+	}
+	return routing;
+}
+
+template<typename Router>
+void check_routing(const Router& router, const PinNetlist& pin_to_pin_netlist, const TestDevice& dev, const std::string& test_name) {
+	const auto violations = algo::verify_routing(router.result(), pin_to_pin_netlist, dev);
+	if (!violations.empty()) {
+		throw std::runtime_error(test_name + ": " + std::to_string(violations.size()) + " routing violations");
+	}
+
+	// everything routed must be known to be used by the net it's in
+	for (const auto& root : router.result().netlist().roots()) {
+		router.result().netlist().for_all_descendants(root, 0, [&](const RouteElementID& id, int) {
+			const auto net = router.netUsing(id);
+			if (!net || *net != root.asPin()) {
+				throw std::runtime_error(test_name + ": a route element isn't recorded as used by its net");
+			}
+			return 0;
+		});
+	}
+}
+
+}
+
+/**
+ * Added connections go onto their net's existing routing, and a new net is routed
+ * around the others, which are left exactly as they were.
+ */
+void added_connections_are_routed_around_other_nets() {
+	const auto dev = make_test_device(2);
+
+	PinNetlist before;
+	before.addConnection(pin(1,1,1), pin(3,1,1));
+	before.addConnection(pin(1,3,1), pin(3,3,1));
+	auto previous = route_from_scratch(before, dev);
+	if (!previous.unroutedPins().empty()) {
+		throw std::runtime_error("added connections: the starting netlist should route");
+	}
+	const auto net_a_before = routing_of_net(previous, pin(1,1,1));
+	const auto net_c_before = routing_of_net(previous, pin(1,3,1));
+
+	algo::NetlistDelta delta;
+	delta.added.emplace_back(pin(1,1,1), pin(3,2,3));
+	delta.added.emplace_back(pin(2,2,2), pin(1,2,4));
+	const auto after = algo::apply_delta(before, delta);
+
+	algo::IncrementalRouter<PinNetlist, TestDevice> router(std::move(previous), dev);
+	router.apply(after, delta);
+
+	check_routing(router, after, dev, "added connections");
+	if (!router.result().unroutedPins().empty()) {
+		throw std::runtime_error("added connections: they should all route");
+	}
+	const auto net_a_after = routing_of_net(router.result(), pin(1,1,1));
+	for (const auto& id : net_a_before) {
+		if (net_a_after.find(id) == end(net_a_after)) {
+			throw std::runtime_error("added connections: the net added to should keep its existing routing");
+		}
+	}
+	if (routing_of_net(router.result(), pin(1,3,1)) != net_c_before) {
+		throw std::runtime_error("added connections: an untouched net was rerouted");
+	}
+}
+
+/**
+ * A net that loses a connection is rerouted without it, and what only the removed
+ * connection used is free again.
+ */
+void removed_connection_is_ripped_up() {
+	const auto dev = make_test_device(2);
+
+	PinNetlist before;
+	before.addConnection(pin(1,1,1), pin(3,1,1));
+	before.addConnection(pin(1,1,1), pin(1,3,1));
+	auto previous = route_from_scratch(before, dev);
+	const auto net_before = routing_of_net(previous, pin(1,1,1));
+
+	algo::NetlistDelta delta;
+	delta.removed.emplace_back(pin(1,1,1), pin(1,3,1));
+	const auto after = algo::apply_delta(before, delta);
+
+	algo::IncrementalRouter<PinNetlist, TestDevice> router(std::move(previous), dev);
+	router.apply(after, delta);
+
+	check_routing(router, after, dev, "removed connection");
+	if (!router.result().unroutedPins().empty()) {
+		throw std::runtime_error("removed connection: what's left should route");
+	}
+	const auto net_after = routing_of_net(router.result(), pin(1,1,1));
+	if (net_after.find(RouteElementID(pin(1,3,1))) != end(net_after)) {
+		throw std::runtime_error("removed connection: its sink is still routed to");
+	}
+	for (const auto& id : net_before) {
+		if (net_after.find(id) == end(net_after) && router.netUsing(id)) {
+			throw std::runtime_error("removed connection: something it used is still marked as used");
+		}
+	}
+}
+
+/**
+ * With one track, a new connection whose only way in is used by another net can only
+ * route by ripping that net up, which is then rerouted around it (or left unrouted).
+ */
+void blocked_connection_rips_up_whats_in_the_way() {
+	const auto dev = make_test_device(1);
+
+	PinNetlist before;
+	before.addConnection(pin(1,1,1), pin(3,1,1));
+	auto previous = route_from_scratch(before, dev);
+	if (!previous.unroutedPins().empty()) {
+		throw std::runtime_error("blocked connection: the starting netlist should route");
+	}
+
+	const auto blocked_src = pin(1,2,2);
+	const auto blocked_sink = pin(2,1,1);
+	{
+		util::FlatHashSet<RouteElementID> used;
+		for (const auto& id : previous.netlist().all_ids()) {
+			used.insert(id);
+		}
+		algo::MazeRouteWorkspace<RouteElementID> workspace;
+		const std::unordered_set<RouteElementID> used_by_this_net{RouteElementID(blocked_src)};
+		if (algo::detail::route_connection(blocked_src, blocked_sink, used_by_this_net, used, dev, 1, nullptr, workspace)) {
+			throw std::runtime_error("blocked connection: the test's connection isn't actually blocked");
+		}
+	}
+
+	algo::NetlistDelta delta;
+	delta.added.emplace_back(blocked_src, blocked_sink);
+	const auto after = algo::apply_delta(before, delta);
+
+	algo::IncrementalRouter<PinNetlist, TestDevice> router(std::move(previous), dev);
+	router.apply(after, delta);
+
+	check_routing(router, after, dev, "blocked connection");
+	const auto new_net = routing_of_net(router.result(), blocked_src);
+	if (new_net.find(RouteElementID(blocked_sink)) == end(new_net)) {
+		throw std::runtime_error("blocked connection: it wasn't routed");
+	}
+	if (!router.result().unroutedPins().fanout(blocked_src).empty()) {
+		throw std::runtime_error("blocked connection: it's still listed as unrouted");
+	}
+}
+
+int main() {
+	added_connections_are_routed_around_other_nets();
+	removed_connection_is_ripped_up();
+	blocked_connection_rips_up_whats_in_the_way();
+}
@@ -0,0 +1,198 @@
+#include "../route_verifier.hpp"
+#include "../routing.hpp"
+
+#include <device/connectors.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using device::PinGID;
+using device::RouteElementID;
+
+using TestDevice = device::Device<device::FullyConnectedConnector>;
+using PinNetlist = util::Netlist<PinGID>;
+using Violation = algo::RoutingViolation;
+
+namespace {
+
+TestDevice make_test_device() {
+	return TestDevice(device::DeviceInfo{device::DeviceType::FullyConnected, geom::BoundBox<int>(0,0,4,4), 2, 1, 2});
+}
+
+PinGID pin(std::int16_t x, std::int16_t y, std::int16_t block_pin) {
+	return util::make_id<PinGID>(
+		util::make_id<device::BlockID>(util::make_id<device::XID>(x), util::make_id<device::YID>(y)),
+		util::make_id<device::BlockPinID>(block_pin)
+	);
+}
+
+/**
+ * Two nets along the bottom and top of the device, routed legally
+ */
+struct TwoNets {
+	const TestDevice dev = make_test_device();
+	PinNetlist pin_to_pin_netlist = make_netlist();
+	algo::RouteAllResult<PinNetlist> result = route(pin_to_pin_netlist, dev);
+
+	static const PinGID net_a;
+	static const PinGID net_c;
+
+	static PinNetlist make_netlist() {
+		PinNetlist netlist;
+		netlist.addConnection(net_a, pin(3,1,1));
+		netlist.addConnection(net_c, pin(3,3,1));
+		return netlist;
+	}
+
+	static algo::RouteAllResult<PinNetlist> route(const PinNetlist& pin_to_pin_netlist, const TestDevice& dev) {
+		const std::vector<PinGID> net_order(begin(pin_to_pin_netlist.roots()), end(pin_to_pin_netlist.roots()));
+		return algo::route_all<false>(pin_to_pin_netlist, net_order, dev);
+	}
+
+	bool isUsed(const RouteElementID& re) const {
+		for (const auto& id : result.netlist().all_ids()) {
+			if (id == re) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool isInFanout(const RouteElementID& from, const RouteElementID& to) const {
+		for (const auto& fanout : util::fanout_of(dev, from)) {
+			if (fanout == to) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * A wire that no net uses, and that isn't in the fanout of `not_from`
+	 */
+	RouteElementID unusedWire(const RouteElementID& not_from) const {
+		for (const auto& block : dev.blocks()) {
+			for (const auto& block_pin : dev.fanout(block)) {
+				for (const auto& wire : util::fanout_of(dev, RouteElementID(block_pin))) {
+					if (!wire.isPin() && !isUsed(wire) && !isInFanout(not_from, wire)) {
+						return wire;
+					}
+				}
+			}
+		}
+		throw std::runtime_error("the test device has no unused wire");
+	}
+};
+
+const PinGID TwoNets::net_a = pin(1,1,1);
+const PinGID TwoNets::net_c = pin(1,3,1);
+
+/**
+ * Throws unless verify_routing finds exactly one violation, of type `expected`
+ */
+Violation expect_one_violation(const TwoNets& nets, Violation::Type expected, const std::string& test_name) {
+	const auto violations = algo::verify_routing(nets.result, nets.pin_to_pin_netlist, nets.dev);
+	if (violations.size() != 1) {
+		throw std::runtime_error(test_name + ": expected 1 violation, but found " + std::to_string(violations.size()));
+	}
+	if (violations.front().type != expected) {
+		throw std::runtime_error(test_name + ": found the wrong type of violation");
+	}
+	return violations.front();
+}
+
+}
+
+/**
+ * If what's broken in the tests below is actually caught, then it isn't already broken
+ */
+void legal_routing_has_no_violations() {
+	const TwoNets nets;
+	if (!nets.result.unroutedPins().empty()) {
+		throw std::runtime_error("legal routing: the test's nets should route");
+	}
+	if (!algo::verify_routing(nets.result, nets.pin_to_pin_netlist, nets.dev).empty()) {
+		throw std::runtime_error("legal routing: violations were found");
+	}
+}
+
+void edge_not_in_device_fanout_is_illegal() {
+	TwoNets nets;
+	const auto source = RouteElementID(TwoNets::net_a);
+	const auto wire = nets.unusedWire(source);
+	nets.result.netlist().addConnection(source, wire);
+
+	const auto violation = expect_one_violation(nets, Violation::Type::IllegalEdge, "illegal edge");
+	if (violation.net != TwoNets::net_a || violation.where != source || violation.to != wire) {
+		throw std::runtime_error("illegal edge: the violation isn't about the added edge");
+	}
+}
+
+/**
+ * Net a is routed into the sink of a third net, which that net didn't reach (and says so)
+ */
+void route_into_other_nets_pin_is_caught() {
+	TwoNets nets;
+	boost::optional<std::pair<RouteElementID, PinGID>> wire_and_pin;
+	nets.result.netlist().for_all_descendants(RouteElementID(TwoNets::net_a), 0, [&](const RouteElementID& id, int) {
+		if (!id.isPin() && !wire_and_pin) {
+			for (const auto& fanout : util::fanout_of(nets.dev, id)) {
+				if (fanout.isPin() && !nets.isUsed(fanout) && !wire_and_pin) {
+					wire_and_pin = std::make_pair(id, fanout.asPin());
+				}
+			}
+		}
+		return 0;
+	});
+	if (!wire_and_pin) {
+		throw std::runtime_error("other net's pin: net a doesn't pass by any free pins");
+	}
+
+	const auto other_source = pin(1,2,1);
+	nets.pin_to_pin_netlist.addConnection(other_source, wire_and_pin->second);
+	nets.result.unroutedPins().addConnection(other_source, wire_and_pin->second);
+	nets.result.netlist().addConnection(wire_and_pin->first, RouteElementID(wire_and_pin->second));
+
+	const auto violation = expect_one_violation(nets, Violation::Type::OtherNetsPin, "other net's pin");
+	if (violation.net != TwoNets::net_a || violation.to != RouteElementID(wire_and_pin->second)) {
+		throw std::runtime_error("other net's pin: the violation isn't about the pin routed into");
+	}
+}
+
+void sink_not_reached_or_listed_as_unrouted_is_caught() {
+	TwoNets nets;
+	const auto forgotten_sink = pin(3,2,1);
+	nets.pin_to_pin_netlist.addConnection(TwoNets::net_a, forgotten_sink);
+
+	const auto violation = expect_one_violation(nets, Violation::Type::UnconnectedSink, "unconnected sink");
+	if (violation.net != TwoNets::net_a || violation.to != RouteElementID(forgotten_sink)) {
+		throw std::runtime_error("unconnected sink: the violation isn't about the forgotten sink");
+	}
+
+	// but it's fine once it's admitted to
+	nets.result.unroutedPins().addConnection(TwoNets::net_a, forgotten_sink);
+	if (!algo::verify_routing(nets.result, nets.pin_to_pin_netlist, nets.dev).empty()) {
+		throw std::runtime_error("unconnected sink: a sink listed as unrouted was reported");
+	}
+}
+
+void routing_not_from_any_net_is_caught() {
+	TwoNets nets;
+	const auto stray = nets.unusedWire(RouteElementID(TwoNets::net_a));
+	nets.result.netlist().addLoneNode(stray);
+
+	const auto violation = expect_one_violation(nets, Violation::Type::NotInAnyNet, "stray root");
+	if (violation.where != stray) {
+		throw std::runtime_error("stray root: the violation isn't about the stray routing");
+	}
+}
+
+int main() {
+	legal_routing_has_no_violations();
+	edge_not_in_device_fanout_is_illegal();
+	route_into_other_nets_pin_is_caught();
+	sink_not_reached_or_listed_as_unrouted_is_caught();
+	routing_not_from_any_net_is_caught();
+}
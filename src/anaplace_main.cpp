@@ -5,6 +5,7 @@
 #include <parsing/anaplace_datafile_parser.hpp>
 #include <util/lambda_compose.hpp>
 #include <util/logging.hpp>
+#include <util/memory_usage.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -30,8 +31,23 @@ int main(int argc, char const** argv) {
 		dout.enable_level(l);
 	}
 
+	if (parsed_args.meta().shouldLogAsynchronously()) {
+		dout.startAsyncWriter();
+	}
+
+	if (!parsed_args.meta().getProfileTraceFileName().empty()) {
+		util::Profiler::get().enable();
+	}
+
+	if (parsed_args.meta().shouldReportMemory()) {
+		util::MemoryLedger::get().enable();
+	}
+
 	// enable graphics
-	if (parsed_args.meta().shouldEnableGraphics()) {
+	if (!parsed_args.meta().getGraphicsRecordingPrefix().empty()) {
+		graphics::get().enableRecording(parsed_args.meta().getGraphicsRecordingPrefix());
+		graphics::get().startThreadsAndOpenWindow();
+	} else if (parsed_args.meta().shouldEnableGraphics()) {
 		graphics::get().enable();
 		graphics::get().startThreadsAndOpenWindow();
 	}
@@ -41,6 +57,16 @@ int main(int argc, char const** argv) {
 	graphics::get().close();
 	graphics::get().join();
 
+	if (!parsed_args.meta().getProfileTraceFileName().empty()) {
+		util::write_profile_report(parsed_args.meta().getProfileTraceFileName());
+	}
+
+	if (parsed_args.meta().shouldReportMemory()) {
+		util::write_memory_report();
+	}
+
+	dout.stopAsyncWriter();
+
 	return result;
 }
 
@@ -0,0 +1,369 @@
+/**
+ * Micro-benchmarks of the hot paths under routing, for tracking regressions.
+ *
+ * Prints one JSON object per line for each benchmark: its name, parameters,
+ * how many times it ran, and the mean time per operation (what an operation is
+ * depends on the benchmark - a route element, a fanout, a netlist node, ...).
+ *
+ * Usage: bench-micro [--filter SUBSTRING] [--min-time SECONDS] [--grid-size N] [--track-width W]
+ */
+
+#include <device/connectors.hpp>
+#include <device/device.hpp>
+#include <util/flat_hash.hpp>
+#include <util/frozen_netlist.hpp>
+#include <util/graph_algorithms.hpp>
+#include <util/netlist.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Options {
+	std::string filter = "";
+	double min_time_seconds = 0.25;
+	int grid_size = 30;
+	int track_width = 10;
+};
+
+Options parse_options(int argc, char const** argv) {
+	Options options;
+	for (int iarg = 1; iarg < argc; ++iarg) {
+		const std::string arg = argv[iarg];
+		if (iarg + 1 >= argc) {
+			throw std::invalid_argument("expected a value after " + arg);
+		}
+		const std::string value = argv[++iarg];
+		if (arg == "--filter") {
+			options.filter = value;
+		} else if (arg == "--min-time") {
+			options.min_time_seconds = std::stod(value);
+		} else if (arg == "--grid-size") {
+			options.grid_size = std::stoi(value);
+		} else if (arg == "--track-width") {
+			options.track_width = std::stoi(value);
+		} else {
+			throw std::invalid_argument("unknown argument " + arg);
+		}
+	}
+	return options;
+}
+
+// results are added in here, so that the work can't be optimized out
+volatile std::uint64_t g_sink = 0;
+
+class BenchmarkRunner {
+public:
+	explicit BenchmarkRunner(const Options& options) : options(options) { }
+
+	/**
+	 * Runs one_iteration repeatedly for at least the minimum time. It should return
+	 * the number of operations it did, and add something it computed to g_sink.
+	 */
+	void run(const std::string& name, const std::string& params, const std::function<std::size_t()>& one_iteration) {
+		if ((name + ' ' + params).find(options.filter) == std::string::npos) {
+			return;
+		}
+
+		using Clock = std::chrono::steady_clock;
+		one_iteration(); // warm up
+
+		std::size_t iterations = 0;
+		std::size_t ops = 0;
+		const auto start = Clock::now();
+		auto elapsed = Clock::duration::zero();
+		do {
+			ops += one_iteration();
+			iterations += 1;
+			elapsed = Clock::now() - start;
+		} while (std::chrono::duration<double>(elapsed).count() < options.min_time_seconds);
+
+		const auto elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		std::cout
+			<< "{\"name\": \"" << name << "\""
+			<< ", \"params\": {" << params << "}"
+			<< ", \"iterations\": " << iterations
+			<< ", \"ops_per_iteration\": " << ops/iterations
+			<< ", \"ns_per_op\": " << elapsed_ns/static_cast<double>(std::max<std::size_t>(1, ops))
+			<< ", \"ns_per_iteration\": " << elapsed_ns/static_cast<double>(iterations)
+			<< "}" << std::endl;
+	}
+
+private:
+	const Options& options;
+};
+
+std::string params_string(std::initializer_list<std::pair<const char*, std::string>> params) {
+	std::ostringstream os;
+	bool first = true;
+	for (const auto& param : params) {
+		os << (first ? "" : ", ") << '"' << param.first << "\": " << param.second;
+		first = false;
+	}
+	return os.str();
+}
+
+std::string quoted(const std::string& s) { return '"' + s + '"'; }
+
+template<typename Device>
+std::vector<device::RouteElementID> all_route_elements(const Device& dev) {
+	std::vector<device::RouteElementID> result;
+	const auto& connector = dev.getConnector();
+	for (int irow = 0; irow < connector.num_route_element_rows(); ++irow) {
+		connector.for_each_route_element_in_row(irow, [&](const device::RouteElementID& re) {
+			result.push_back(re);
+		});
+	}
+	return result;
+}
+
+device::PinGID pin_at(int x, int y, int pin_number) {
+	return device::PinGID(
+		device::BlockID(util::make_id<device::XID>(static_cast<device::XID::IDType>(x)), util::make_id<device::YID>(static_cast<device::YID::IDType>(y))),
+		util::make_id<device::BlockPinID>(static_cast<device::BlockPinID::IDType>(pin_number))
+	);
+}
+
+template<typename Device>
+void fanout_benchmarks(BenchmarkRunner& runner, const std::string& connector_name, const Device& dev) {
+	const auto res = all_route_elements(dev);
+	const auto params = params_string({
+		{"connector", quoted(connector_name)},
+		{"grid_size", std::to_string(dev.info().bounds.get_width() + 1)},
+		{"track_width", std::to_string(dev.info().track_width)},
+	});
+
+	runner.run("fanout_generator", params, [&]() {
+		std::uint64_t sum = 0;
+		for (const auto& re : res) {
+			for (const auto& fanout : dev.fanout(re)) {
+				sum += fanout.getValue();
+			}
+		}
+		g_sink += sum;
+		return res.size();
+	});
+
+	runner.run("fanout_preferred", params, [&]() {
+		std::uint64_t sum = 0;
+		for (const auto& re : res) {
+			for (const auto& fanout : util::fanout_of(dev, re)) {
+				sum += fanout.getValue();
+			}
+		}
+		g_sink += sum;
+		return res.size();
+	});
+}
+
+template<typename Device>
+void traversal_benchmarks(BenchmarkRunner& runner, const std::string& connector_name, const Device& dev) {
+	using device::RouteElementID;
+
+	const auto grid_size = dev.info().bounds.get_width() + 1;
+	const auto source = RouteElementID(pin_at(0, 0, 1));
+	const auto target = RouteElementID(pin_at(grid_size - 1, grid_size - 1, 1));
+	const std::vector<RouteElementID> initial_list{source};
+	const auto is_other_pin = [&](const RouteElementID& re) {
+		return re.isPin() && re != source && re != target;
+	};
+
+	runner.run("breadth_first_visit", params_string({{"connector", quoted(connector_name)}, {"grid_size", std::to_string(grid_size)}}), [&]() {
+		std::size_t num_visited = 0;
+		util::GraphAlgo<RouteElementID>().breadthFirstVisit(dev, initial_list, [&](const RouteElementID&) {
+			num_visited += 1;
+		}, is_other_pin);
+		g_sink += num_visited;
+		return num_visited;
+	});
+
+	for (const int nthreads : {1, 2, 4}) {
+		runner.run("waved_breadth_first_visit", params_string({{"connector", quoted(connector_name)}, {"grid_size", std::to_string(grid_size)}, {"threads", std::to_string(nthreads)}}), [&]() {
+			const auto tree = util::GraphAlgo<RouteElementID>().withThreads(nthreads).wavedBreadthFirstVisit(
+				dev, initial_list, [&](const RouteElementID& re) { return re == target; }, util::DefaultGraphVisitor<RouteElementID>(), is_other_pin
+			);
+			std::size_t path_length = 0;
+			for (auto curr = tree.parent(target); curr; curr = tree.parent(*curr)) {
+				path_length += 1;
+			}
+			g_sink += path_length;
+			return std::size_t(1);
+		});
+
+		util::SearchWorkspace<RouteElementID> workspace;
+		runner.run("waved_breadth_first_visit_with_workspace", params_string({{"connector", quoted(connector_name)}, {"grid_size", std::to_string(grid_size)}, {"threads", std::to_string(nthreads)}}), [&]() {
+			const auto tree = util::GraphAlgo<RouteElementID>().withThreads(nthreads).wavedBreadthFirstVisit(
+				dev, initial_list, [&](const RouteElementID& re) { return re == target; }, util::DefaultGraphVisitor<RouteElementID>(), is_other_pin, &workspace
+			);
+			std::size_t path_length = 0;
+			for (auto curr = tree.parent(target); curr; curr = tree.parent(*curr)) {
+				path_length += 1;
+			}
+			g_sink += path_length;
+			return std::size_t(1);
+		});
+	}
+}
+
+void netlist_benchmarks(BenchmarkRunner& runner) {
+	using device::RouteElementID;
+
+	// random trees, a bit like routing results
+	const std::size_t num_trees = 500;
+	const std::size_t nodes_per_tree = 200;
+	std::mt19937 rng(42);
+	std::vector<std::pair<RouteElementID, RouteElementID>> connections;
+	for (std::size_t itree = 0; itree < num_trees; ++itree) {
+		const auto base = itree*nodes_per_tree;
+		for (std::size_t inode = 1; inode < nodes_per_tree; ++inode) {
+			const auto parent = std::uniform_int_distribution<std::size_t>(inode > 8 ? inode - 8 : 0, inode - 1)(rng);
+			connections.emplace_back(util::make_id<RouteElementID>(base + parent), util::make_id<RouteElementID>(base + inode));
+		}
+	}
+	const auto params = params_string({{"trees", std::to_string(num_trees)}, {"nodes_per_tree", std::to_string(nodes_per_tree)}});
+
+	runner.run("netlist_insert", params, [&]() {
+		util::Netlist<RouteElementID> netlist;
+		for (const auto& connection : connections) {
+			netlist.addConnection(connection.first, connection.second);
+		}
+		g_sink += netlist.roots().size();
+		return connections.size();
+	});
+
+	util::Netlist<RouteElementID> netlist;
+	for (const auto& connection : connections) {
+		netlist.addConnection(connection.first, connection.second);
+	}
+
+	runner.run("netlist_traverse", params, [&]() {
+		std::size_t num_visited = 0;
+		for (const auto& root : netlist.roots()) {
+			netlist.for_all_descendants(root, 0, [&](const RouteElementID&, int depth) {
+				num_visited += 1;
+				return depth + 1;
+			});
+		}
+		g_sink += num_visited;
+		return num_visited;
+	});
+
+	runner.run("frozen_netlist_freeze", params, [&]() {
+		const util::FrozenNetlist<RouteElementID> frozen(netlist);
+		g_sink += frozen.size();
+		return frozen.size();
+	});
+
+	const util::FrozenNetlist<RouteElementID> frozen(netlist);
+	runner.run("frozen_netlist_traverse", params, [&]() {
+		std::size_t num_visited = 0;
+		for (const auto& root : frozen.roots()) {
+			frozen.for_all_descendants(root, 0, [&](const RouteElementID&, int depth) {
+				num_visited += 1;
+				return depth + 1;
+			});
+		}
+		g_sink += num_visited;
+		return num_visited;
+	});
+}
+
+template<typename Device>
+void hashing_benchmarks(BenchmarkRunner& runner, const Device& dev) {
+	using device::RouteElementID;
+
+	const auto res = all_route_elements(dev);
+	const auto params = params_string({{"num_ids", std::to_string(res.size())}});
+
+	runner.run("hash_std", params, [&]() {
+		std::size_t sum = 0;
+		for (const auto& re : res) {
+			sum += std::hash<RouteElementID>()(re);
+		}
+		g_sink += sum;
+		return res.size();
+	});
+
+	runner.run("hash_mixing", params, [&]() {
+		std::size_t sum = 0;
+		for (const auto& re : res) {
+			sum += util::MixingHash<RouteElementID>()(re);
+		}
+		g_sink += sum;
+		return res.size();
+	});
+
+	runner.run("set_insert_find_unordered_set", params, [&]() {
+		std::unordered_set<RouteElementID> set;
+		for (const auto& re : res) {
+			set.insert(re);
+		}
+		std::size_t found = 0;
+		for (const auto& re : res) {
+			found += set.count(re);
+		}
+		g_sink += found;
+		return res.size();
+	});
+
+	runner.run("set_insert_find_flat_hash_set", params, [&]() {
+		util::FlatHashSet<RouteElementID> set;
+		for (const auto& re : res) {
+			set.insert(re);
+		}
+		std::size_t found = 0;
+		for (const auto& re : res) {
+			found += set.count(re);
+		}
+		g_sink += found;
+		return res.size();
+	});
+}
+
+} // end anonymous namespace
+
+int main(int argc, char const** argv) {
+	Options options;
+	try {
+		options = parse_options(argc, argv);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\nusage: " << argv[0] << " [--filter SUBSTRING] [--min-time SECONDS] [--grid-size N] [--track-width W]\n";
+		return 1;
+	}
+
+	BenchmarkRunner runner(options);
+
+	const device::DeviceInfo dev_info{
+		device::DeviceTypeID(),
+		geom::BoundBox<int>(0, 0, options.grid_size - 1, options.grid_size - 1),
+		options.track_width,
+		1,
+		2,
+	};
+
+	const device::Device<device::FullyConnectedConnector> fc(dev_info);
+	const device::Device<device::WiltonConnector> wilton(dev_info);
+	const device::Device<device::FanoutPreCachingConnector<device::FullyConnectedConnector>> fc_precached(dev_info);
+	const device::Device<device::FanoutPreCachingConnector<device::WiltonConnector>> wilton_precached(dev_info);
+
+	fanout_benchmarks(runner, "fully-connected", fc);
+	fanout_benchmarks(runner, "wilton", wilton);
+	fanout_benchmarks(runner, "fully-connected-precached", fc_precached);
+	fanout_benchmarks(runner, "wilton-precached", wilton_precached);
+
+	traversal_benchmarks(runner, "wilton", wilton);
+	traversal_benchmarks(runner, "wilton-precached", wilton_precached);
+
+	netlist_benchmarks(runner);
+	hashing_benchmarks(runner, wilton);
+}
@@ -0,0 +1,105 @@
+/**
+ * Writes a synthetic routing problem, in the format maize-router reads, for stress
+ * testing and scaling studies on circuits bigger than the ones we have.
+ *
+ * Usage: maize-circuit-gen --output FILE [--grid-size N] [--track-width W] [--connections C]
+ *        [--rent-exponent P] [--fanout F] [--seed S]
+ */
+
+#include <algo/synthetic_circuit.hpp>
+#include <parsing/routing_input_parser.hpp>
+#include <util/logging.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char* const USAGE =
+	" --output FILE [--grid-size N] [--track-width W] [--connections C]"
+	" [--rent-exponent P] [--fanout F] [--seed S]";
+
+struct Options {
+	algo::SyntheticCircuitParams params = {};
+	std::string output_file_name = "";
+};
+
+Options parse_options(int argc, char const** argv) {
+	Options options;
+	for (int iarg = 1; iarg < argc; ++iarg) {
+		const std::string arg = argv[iarg];
+		if (iarg + 1 >= argc) {
+			throw std::invalid_argument("expected a value after " + arg);
+		}
+		const std::string value = argv[++iarg];
+		if (arg == "--output") {
+			options.output_file_name = value;
+		} else if (arg == "--grid-size") {
+			options.params.grid_size = std::stoi(value);
+		} else if (arg == "--track-width") {
+			options.params.track_width = std::stoi(value);
+		} else if (arg == "--connections") {
+			options.params.num_connections = std::stoul(value);
+		} else if (arg == "--rent-exponent") {
+			options.params.rent_exponent = std::stod(value);
+		} else if (arg == "--fanout") {
+			options.params.mean_fanout = std::stod(value);
+		} else if (arg == "--seed") {
+			options.params.seed = std::stoull(value);
+		} else {
+			throw std::invalid_argument("unknown argument " + arg);
+		}
+	}
+	if (options.output_file_name.empty()) {
+		throw std::invalid_argument("--output is required");
+	}
+	return options;
+}
+
+/**
+ * Throws std::invalid_argument if the params describe a circuit that can't be made
+ */
+void write_circuit(const Options& options) {
+	const auto& params = options.params;
+	const auto circuit = algo::make_synthetic_circuit(params);
+
+	std::ofstream output(options.output_file_name);
+	if (!output) {
+		util::print_and_throw<std::runtime_error>([&](auto&& str) {
+			str << "couldn't open " << options.output_file_name << " for writing";
+		});
+	}
+	parsing::routing::input::write_data(output, circuit.device_info, circuit.connections);
+
+	dout(DL::INFO) << "wrote " << circuit.connections.size() << " connections on a "
+		<< params.grid_size << 'x' << params.grid_size << " grid with track width " << params.track_width
+		<< " (Rent's exponent " << params.rent_exponent << ", mean fanout " << params.mean_fanout
+		<< ", seed " << params.seed << ") to " << options.output_file_name << '\n';
+}
+
+} // end anonymous namespace
+
+int main(int argc, char const** argv) {
+	for (auto& l : DebugLevel::getDefaultSet()) {
+		dout.enable_level(l);
+	}
+
+	Options options;
+	try {
+		options = parse_options(argc, argv);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\nusage: " << argv[0] << USAGE << '\n';
+		return 1;
+	}
+
+	try {
+		write_circuit(options);
+	} catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << "\nusage: " << argv[0] << USAGE << '\n';
+		return 1;
+	}
+
+	return 0;
+}
@@ -2,18 +2,21 @@
 #define DEVICE__CONNECTORS_H
 
 #include <device/device.hpp>
+#include <device/rr_graph_file.hpp>
+#include <util/bump_allocator.hpp>
 #include <util/graph_algorithms.hpp>
 #include <util/logging.hpp>
+#include <util/memory_usage.hpp>
 #include <util/netlist.hpp>
 #include <util/template_utils.hpp>
 
+#include <atomic>
 #include <memory>
-#include <mutex>
-#include <shared_mutex>
+#include <thread>
 
 #include <boost/optional.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <boost/variant.hpp>
-#include <boost/thread/shared_mutex.hpp>
 
 namespace device {
 
@@ -34,6 +37,23 @@ namespace {
 		);
 	}
 
+	/**
+	 * fanout_batch for connectors that already have each fanout stored somewhere
+	 */
+	template<typename Connector>
+	void append_cached_fanouts(const Connector& connector, const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) {
+		for (std::size_t isource = 0; isource < num_sources; ++isource) {
+			for (
+				auto it = connector.fanout_begin(sources[isource]);
+				!connector.is_end_index(sources[isource], it);
+				it = connector.next_fanout(sources[isource], it)
+			) {
+				out.push_back(connector.re_from_index(sources[isource], it));
+			}
+			ends.push_back(out.size());
+		}
+	}
+
 	BlockID offset_block(const BlockID& bid, int xdiff, int ydiff, bool swap_xy = false) {
 		return BlockID(
 			util::make_id<XID>(static_cast<XID::IDType>(bid.getX().getValue() + (swap_xy ? ydiff : xdiff))),
@@ -190,6 +210,103 @@ struct FullyConnectedConnector {
 		}
 	}
 
+	/**
+	 * Batch form of fanout_begin/next_fanout/re_from_index. Appends the fanout of each
+	 * of the num_sources REs at sources to `out` (in the same order as the one-at-a-time
+	 * protocol), and after each source, pushes the size of `out` onto `ends`.
+	 */
+	void fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const {
+		filtered_fanout_batch(sources, num_sources, out, ends, [](const RouteElementID&, const RouteElementID&) { return true; });
+	}
+
+	/**
+	 * The work is done in two passes per source, so that neither has to stop and
+	 * decide anything per candidate: first every candidate next_fanout would
+	 * consider is written straight into `out`, then they are compacted in place,
+	 * keeping those that are legal and that extra_filter(source, candidate) allows.
+	 */
+	template<typename ExtraFilter>
+	void filtered_fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends, ExtraFilter&& extra_filter) const {
+		for (std::size_t isource = 0; isource < num_sources; ++isource) {
+			const auto& re = sources[isource];
+			const auto candidates_begin = out.size();
+			append_fanout_candidates(re, out);
+
+			auto num_kept = candidates_begin;
+			for (auto icandidate = candidates_begin; icandidate < out.size(); ++icandidate) {
+				const auto candidate = out[icandidate];
+				out[num_kept] = candidate;
+				num_kept += static_cast<std::size_t>(is_legal_fanout_candidate(candidate) & extra_filter(re, candidate));
+			}
+			out.resize(num_kept);
+			ends.push_back(num_kept);
+		}
+	}
+
+	/**
+	 * Appends re_from_index(re, i) for every index next_fanout would consider,
+	 * legal or not, computing them by channel instead of one index at a time
+	 */
+	void append_fanout_candidates(const RouteElementID& re, std::vector<RouteElementID>& out) const {
+		const auto track_width = dev_info.track_width;
+		auto candidate = out.size();
+
+		if (re.isPin()) {
+			// all the wires a pin connects to are in the same channel, in index order
+			const auto first_wire = re_from_index(re, 0);
+			out.resize(candidate + static_cast<std::size_t>(track_width));
+			for (int i = 0; i < track_width; ++i) {
+				out[candidate++] = RouteElementID(first_wire.getX(), first_wire.getY(), static_cast<RouteElementID::REIndex>(first_wire.getIndex() + i));
+			}
+			return;
+		}
+
+		const auto num_adjacent = dev_info.num_blocks_adjacent_to_channel;
+		const auto num_pin_candidates = dev_info.pins_per_block_side*num_adjacent;
+		const bool is_horiz = wire_direction(re) == Direction::HORIZONTAL;
+		out.resize(candidate + static_cast<std::size_t>(num_pin_candidates + track_width*6));
+
+		for (int i = 0; i < num_pin_candidates; ++i) {
+			const auto adjacent = i % num_adjacent;
+			const auto block_pin_id = num_adjacent*adjacent + 1 + (is_horiz ? 0 : 1);
+			const auto xval = re.getX().getValue() - ((!is_horiz && adjacent == 0) ? 1 : 0);
+			const auto yval = re.getY().getValue() - (( is_horiz && adjacent != 0) ? 1 : 0);
+			out[candidate++] = RouteElementID(PinGID(
+				BlockID(util::make_id<XID>(static_cast<XID::IDType>(xval)), util::make_id<YID>(static_cast<YID::IDType>(yval))),
+				util::make_id<BlockPinID>(static_cast<BlockPinID::IDType>(block_pin_id))
+			));
+		}
+
+		// the same table as the switch in re_from_index: where each destination channel
+		// is, and whether its tracks are rotated by a channel's width
+		static const int channel_dx[6]          = {    0,     0,   -1,   -1,     0,    0 };
+		static const int channel_dy[6]          = {    0,    -1,    0,    1,     1,    1 };
+		static const bool channel_is_rotated[6] = { true, false, true, true, false, true };
+		const auto track_offset = is_horiz ? track_width : 0;
+		for (int channel = 0; channel < 6; ++channel) {
+			const auto index_offset = track_offset + (channel_is_rotated[channel] ? track_width : 0);
+			for (int track = 0; track < track_width; ++track) {
+				out[candidate++] = offset_re_new_index(re, channel_dx[channel], channel_dy[channel], (track + index_offset) % (track_width*2), is_horiz);
+			}
+		}
+	}
+
+	/**
+	 * The bounds check from next_fanout, evaluated in full rather than by cases
+	 */
+	bool is_legal_fanout_candidate(const RouteElementID& candidate) const {
+		const auto xy = geom::make_point(
+			candidate.getX().getValue(),
+			candidate.getY().getValue()
+		);
+		const auto dir = wire_direction(candidate);
+		const bool is_pin = candidate.isPin();
+		const bool wire_not_past_end =
+			  ((dir == Direction::HORIZONTAL) & (xy.x() != wire_bb.maxx()))
+			| ((dir == Direction::VERTICAL)   & (xy.y() != wire_bb.maxy()));
+		return (is_pin & dev_info.bounds.intersects(xy)) | (!is_pin & wire_bb.intersects(xy) & wire_not_past_end);
+	}
+
 	static BlockFanoutIndex block_fanout_begin(const BlockID& block) {
 		return PinGID(
 			block,
@@ -240,6 +357,83 @@ struct FullyConnectedConnector {
 		return curr;
 	}
 
+	/*
+	 * A dense numbering of every route element on the device. All the pins
+	 * come first (row-major by block), followed by the wires at each channel
+	 * location. Channels extend one past the blocks in x and y, so there is
+	 * one more row (and column) of wire locations than of blocks.
+	 */
+
+	int num_block_columns() const { return dev_info.bounds.get_width() + 1; }
+	int num_block_rows() const { return dev_info.bounds.get_height() + 1; }
+	int num_route_element_rows() const { return num_block_rows() + 1; }
+	int pins_per_block() const { return dev_info.pins_per_block_side * 4; }
+	int wires_per_location() const { return dev_info.track_width * 2; }
+
+	std::size_t num_pins() const {
+		return static_cast<std::size_t>(num_block_columns() * num_block_rows() * pins_per_block());
+	}
+
+	std::size_t num_route_elements() const {
+		return num_pins() + static_cast<std::size_t>((num_block_columns() + 1) * (num_block_rows() + 1) * wires_per_location());
+	}
+
+	bool is_valid_route_element(const RouteElementID& re) const {
+		if (re.isPin()) {
+			const auto pin = re.asPin();
+			const auto pin_number = pin.getBlockPin().getValue();
+			return dev_info.bounds.intersects(pin.getBlock().x(), pin.getBlock().y())
+				&& 1 <= pin_number && pin_number <= pins_per_block();
+		} else {
+			const auto xy = geom::make_point(re.getX().getValue(), re.getY().getValue());
+			switch (wire_direction(re)) {
+				case Direction::VERTICAL:
+					return re.getIndex() >= 0 && wire_bb.intersects(xy) && xy.y() != wire_bb.maxy();
+				case Direction::HORIZONTAL:
+					return wire_bb.intersects(xy) && xy.x() != wire_bb.maxx();
+				default:
+					return false;
+			}
+		}
+	}
+
+	/**
+	 * The position of `re` in the dense numbering. Only meaningful if is_valid_route_element(re)
+	 */
+	std::size_t route_element_index(const RouteElementID& re) const {
+		if (re.isPin()) {
+			const auto pin = re.asPin();
+			const auto block_number = (pin.getBlock().y() - dev_info.bounds.miny())*num_block_columns() + (pin.getBlock().x() - dev_info.bounds.minx());
+			return static_cast<std::size_t>(block_number*pins_per_block() + pin.getBlockPin().getValue() - 1);
+		} else {
+			const auto location_number = (re.getY().getValue() - dev_info.bounds.miny())*(num_block_columns() + 1) + (re.getX().getValue() - dev_info.bounds.minx());
+			return num_pins() + static_cast<std::size_t>(location_number*wires_per_location() + re.getIndex());
+		}
+	}
+
+	/**
+	 * Call `f` on each valid route element with y value of (bounds.miny() + irow),
+	 * for 0 <= irow < num_route_element_rows()
+	 */
+	template<typename Func>
+	void for_each_route_element_in_row(int irow, Func&& f) const {
+		const auto y = static_cast<YID::IDType>(dev_info.bounds.miny() + irow);
+		for (int x = wire_bb.minx(); x <= wire_bb.maxx(); ++x) {
+			const auto block = BlockID(util::make_id<XID>(static_cast<XID::IDType>(x)), util::make_id<YID>(y));
+			if (dev_info.bounds.intersects(x, y)) {
+				for (int pin_number = 1; pin_number <= pins_per_block(); ++pin_number) {
+					f(RouteElementID(PinGID(block, util::make_id<BlockPinID>(static_cast<BlockPinID::IDType>(pin_number)))));
+				}
+			}
+			for (int index = 0; index < wires_per_location(); ++index) {
+				const auto wire = RouteElementID(block.getX(), block.getY(), static_cast<RouteElementID::REIndex>(index));
+				if (is_valid_route_element(wire)) {
+					f(wire);
+				}
+			}
+		}
+	}
+
 	static BlockSide get_block_pin_side(PinGID pin) {
 		switch ((pin.getBlockPin().getValue() - 1) % 4 + 1) {
 			case 1:
@@ -305,18 +499,26 @@ public:
 				return next;
 			} else if (result.isPin()) {
 				return next;
-			} else {
-				const auto sides = sides_of_common_switchbox({re, result});
-				if (
-					fanout_allowed_wilton({index_in_channel(    re.getIndex()), sides.first},  {index_in_channel(result.getIndex()), sides.second}) ||
-					fanout_allowed_wilton({index_in_channel(result.getIndex()), sides.second}, {index_in_channel(    re.getIndex()), sides.first})
-				) {
-					return next;
-				}
+			} else if (wire_fanout_allowed_wilton(re, result)) {
+				return next;
 			}
 		}
 	}
 
+	void fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const {
+		filtered_fanout_batch(sources, num_sources, out, ends, [this](const RouteElementID& re, const RouteElementID& result) {
+			return re.isPin() || result.isPin() || wire_fanout_allowed_wilton(re, result);
+		});
+	}
+
+	bool wire_fanout_allowed_wilton(const RouteElementID& re, const RouteElementID& result) const {
+		const auto sides = sides_of_common_switchbox({re, result});
+		return
+			fanout_allowed_wilton({index_in_channel(    re.getIndex()), sides.first},  {index_in_channel(result.getIndex()), sides.second}) ||
+			fanout_allowed_wilton({index_in_channel(result.getIndex()), sides.second}, {index_in_channel(    re.getIndex()), sides.first})
+		;
+	}
+
 	std::pair<BlockSide,BlockSide> sides_of_common_switchbox(std::pair<const RouteElementID&, const RouteElementID&> reids) const {
 		const auto dirs = std::make_pair(wire_direction(reids.first), wire_direction(reids.second));
 		const auto locs = std::make_pair(
@@ -398,53 +600,110 @@ public:
 	}
 };
 
+/**
+ * Computes the fanout of each route element the first time it is asked for,
+ * and remembers it. Safe to share between threads without locking: each RE
+ * has a slot (by dense index) that is published exactly once with a CAS.
+ * If two threads race to fill a slot they compute the same thing, and the
+ * loser's copy is simply never referenced.
+ * Copies share the cache, as it only depends on the DeviceInfo.
+ */
 template<typename BaseConnector>
 class FanoutCachingConnector : public BaseConnector {
-	mutable std::unordered_map<RouteElementID, std::unique_ptr<std::vector<RouteElementID>>> cache = {};
-	mutable std::unique_ptr<boost::shared_mutex> mutex = std::make_unique<boost::shared_mutex>();
+	struct CacheElement {
+		const RouteElementID* first;
+		const RouteElementID* last;
+	};
+
+	struct Cache {
+		explicit Cache(std::size_t num_slots)
+			: slots(num_slots)
+			, element_allocator()
+			, fanout_allocator()
+		{ }
+
+		// indexed by BaseConnector::route_element_index
+		std::vector<std::atomic<const CacheElement*>> slots;
+		util::ConcurrentBumpAllocator<CacheElement> element_allocator;
+		util::ConcurrentBumpAllocator<RouteElementID> fanout_allocator;
+	};
+
+	std::shared_ptr<Cache> cache;
 public:
-	using BaseConnector::BaseConnector;
+	FanoutCachingConnector(const DeviceInfo& dev_info)
+		: BaseConnector(dev_info)
+		, cache(std::make_shared<Cache>(BaseConnector::num_route_elements()))
+	{ }
+	FanoutCachingConnector(const FanoutCachingConnector&) = default;
+	FanoutCachingConnector& operator=(const FanoutCachingConnector&) = default;
+	FanoutCachingConnector(FanoutCachingConnector&&) = default;
+	FanoutCachingConnector& operator=(FanoutCachingConnector&&) = default;
 
-	auto fanout_begin(const RouteElementID& re) const {
-		using std::begin;
-		return begin(get_fanout(re));
+	struct Index {
+		const RouteElementID* curr;
+		const RouteElementID* last;
+
+		bool operator==(const Index& rhs) const {
+			return std::forward_as_tuple(curr, last) == std::forward_as_tuple(rhs.curr, rhs.last);
+		}
+	};
+
+	Index fanout_begin(const RouteElementID& re) const {
+		const auto& cache_element = get_fanout(re);
+		return { cache_element.first, cache_element.last };
 	}
 
-	template<typename Index>
 	bool is_end_index(const RouteElementID& re, const Index& index) const {
-		using std::end;
-		return index == end(get_fanout(re));
+		(void)re;
+		return index.curr == index.last;
 	}
 
-	template<typename Index>
-	auto next_fanout(const RouteElementID& re, const Index& index) const {
+	Index next_fanout(const RouteElementID& re, const Index& index) const {
 		(void)re;
-		return std::next(index);
+		return { std::next(index.curr), index.last };
 	}
 
-	template<typename Index>
 	auto re_from_index(const RouteElementID& re, const Index& out_index) const {
 		(void)re;
-		return *out_index;
+		return *out_index.curr;
 	}
 
-	const auto& get_fanout(const RouteElementID& re) const {
-		using std::end;
-		mutex->lock_shared();
-		const auto find_result = cache.find(re);
-		if (find_result == end(cache)) {
-			mutex->unlock_shared();
-			std::lock_guard<decltype(*mutex)> lock_holder(*mutex);
-			const auto find_result_with_write_perms = cache.find(re);
-			if (find_result == end(cache)) {
-				return *cache.emplace(re, std::make_unique<std::vector<RouteElementID>>(compute_all_fanout(re))).first->second;
-			} else {
-				return *find_result_with_write_perms->second;
-			}
+	boost::iterator_range<const RouteElementID*> fanout_span(const RouteElementID& re) const {
+		const auto& cache_element = get_fanout(re);
+		return { cache_element.first, cache_element.last };
+	}
+
+	void fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const {
+		append_cached_fanouts(*this, sources, num_sources, out, ends);
+	}
+
+	/**
+	 * REs that aren't on the device (eg. a pin past its edge) have no slot, and no fanout.
+	 */
+	const CacheElement& get_fanout(const RouteElementID& re) const {
+		if (!BaseConnector::is_valid_route_element(re)) {
+			static const CacheElement no_fanout = { nullptr, nullptr };
+			return no_fanout;
+		}
+
+		auto& slot = cache->slots[BaseConnector::route_element_index(re)];
+		const auto published = slot.load(std::memory_order_acquire);
+		if (published) {
+			return *published;
+		}
+
+		const auto fanout = compute_all_fanout(re);
+		const auto fanout_storage = cache->fanout_allocator.allocate(fanout.size());
+		std::copy(begin(fanout), end(fanout), fanout_storage);
+
+		const auto new_element = cache->element_allocator.allocate(1);
+		*new_element = CacheElement{ fanout_storage, fanout_storage + fanout.size() };
+
+		const CacheElement* expected = nullptr;
+		if (slot.compare_exchange_strong(expected, new_element, std::memory_order_acq_rel)) {
+			return *new_element;
 		} else {
-			const auto& result = *find_result->second;
-			mutex->unlock_shared();
-			return result;
+			return *expected; // someone else got there first
 		}
 	}
 
@@ -464,11 +723,12 @@ public:
 template<typename BaseConnector>
 class FanoutPreCachingConnector : public BaseConnector {
 	using CacheElement = std::vector<RouteElementID>;
-	std::unordered_map<RouteElementID, CacheElement> cache;
+	// indexed by BaseConnector::route_element_index
+	std::vector<CacheElement> cache;
 public:
-	FanoutPreCachingConnector(const DeviceInfo& dev_info)
+	FanoutPreCachingConnector(const DeviceInfo& dev_info, int nThreads = default_num_cache_threads())
 		: BaseConnector(dev_info)
-		, cache(make_cache(dev_info))
+		, cache(make_cache(dev_info, nThreads))
 	{ }
 	FanoutPreCachingConnector(const FanoutPreCachingConnector&) = default;
 	FanoutPreCachingConnector& operator=(const FanoutPreCachingConnector&) = default;
@@ -506,13 +766,20 @@ public:
 		return *out_index.curr;
 	}
 
+	boost::iterator_range<const RouteElementID*> fanout_span(const RouteElementID& re) const {
+		const auto& cache_element = get_fanout(re);
+		return { cache_element.data(), cache_element.data() + cache_element.size() };
+	}
+
+	void fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const {
+		append_cached_fanouts(*this, sources, num_sources, out, ends);
+	}
+
 	const auto& get_fanout(const RouteElementID& re) const {
-		using std::end;
-		const auto find_result = cache.find(re);
-		if (find_result == end(cache)) {
+		if (!BaseConnector::is_valid_route_element(re)) {
 			throw std::runtime_error("don't have cached connections for a route element");
 		} else {
-			return find_result->second;
+			return cache[BaseConnector::route_element_index(re)];
 		}
 	}
 
@@ -528,31 +795,125 @@ public:
 		return result;
 	}
 
-	static auto make_cache(const DeviceInfo& dev_info) {
-		Device<BaseConnector> device(dev_info);
+	static int default_num_cache_threads() {
+		return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	/**
+	 * Computes the fanout of every route element on the device. The set of
+	 * REs is known up front, so each thread takes a band of rows and fills
+	 * in the (preallocated) slots of the REs in it - no sharing between threads.
+	 */
+	static auto make_cache(const DeviceInfo& dev_info, int nThreads) {
+		const Device<BaseConnector> device(dev_info);
+		const auto& connector = device.getConnector();
 
-		std::vector<RouteElementID> initial_list;
-		for (const auto& block : device.blocks()) {
-			for (const auto& pin : device.fanout(block)) {
-				initial_list.push_back(pin);
+		decltype(FanoutPreCachingConnector::cache) result(connector.num_route_elements());
+
+		const auto num_rows = connector.num_route_element_rows();
+		const auto rows_per_thread = 1 + (num_rows - 1)/nThreads; // rounds up
+		const auto fill_rows = [&](int ithread) {
+			const auto row_end = std::min(num_rows, (ithread + 1)*rows_per_thread);
+			for (int irow = ithread*rows_per_thread; irow < row_end; ++irow) {
+				connector.for_each_route_element_in_row(irow, [&](const RouteElementID& re) {
+					auto& cache_element = result[connector.route_element_index(re)];
+					for (const auto& fanout : device.fanout(re)) {
+						cache_element.emplace_back(fanout);
+					}
+				});
 			}
-		}
+		};
+
+		if (nThreads == 1) {
+			fill_rows(0);
+		} else {
+			std::vector<std::thread> threads;
 
-		decltype(FanoutPreCachingConnector::cache) result;
-		util::GraphAlgo<RouteElementID>().breadthFirstVisit(device, initial_list, [&](auto& re) {
-			for (const auto& fanout : device.fanout(re)) {
-				result[re].emplace_back(fanout);
+			for (int ithread = 0; ithread < nThreads; ++ithread) {
+				threads.emplace_back(fill_rows, ithread);
 			}
-		});
+
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		}
+
+		util::record_memory("FanoutPreCachingConnector cache", [&]() { return util::heap_bytes(result); });
 
 		return result;
 	}
 };
 
+/**
+ * Reads fanout straight out of a flat routing-resource graph image, usually
+ * an mmap'ed file in rr_graph_file::cacheDirectory() written by an earlier run.
+ * If there is no such file, the graph is built (as for FanoutPreCachingConnector)
+ * and written there. Copies share the image.
+ */
+template<typename BaseConnector>
+class FanoutFileCachingConnector : public BaseConnector {
+	rr_graph_file::View graph;
+public:
+	FanoutFileCachingConnector(const DeviceInfo& dev_info, const std::string& cache_directory = rr_graph_file::cacheDirectory())
+		: BaseConnector(dev_info)
+		, graph(rr_graph_file::loadOrMake(dev_info, BaseConnector::num_route_elements(), cache_directory, [this](const RouteElementID& re) {
+			return BaseConnector::is_valid_route_element(re);
+		}, [&]() {
+			return FanoutPreCachingConnector<BaseConnector>::make_cache(dev_info, FanoutPreCachingConnector<BaseConnector>::default_num_cache_threads());
+		}))
+	{ }
+	FanoutFileCachingConnector(const FanoutFileCachingConnector&) = default;
+	FanoutFileCachingConnector& operator=(const FanoutFileCachingConnector&) = default;
+	FanoutFileCachingConnector(FanoutFileCachingConnector&&) = default;
+	FanoutFileCachingConnector& operator=(FanoutFileCachingConnector&&) = default;
+
+	struct Index {
+		const std::uint64_t* curr;
+		const std::uint64_t* last;
+
+		bool operator==(const Index& rhs) const {
+			return std::forward_as_tuple(curr, last) == std::forward_as_tuple(rhs.curr, rhs.last);
+		}
+	};
+
+	Index fanout_begin(const RouteElementID& re) const {
+		if (!BaseConnector::is_valid_route_element(re)) {
+			throw std::runtime_error("don't have cached connections for a route element");
+		}
+		const auto re_index = BaseConnector::route_element_index(re);
+		return { graph.edges + graph.offsets[re_index], graph.edges + graph.offsets[re_index + 1] };
+	}
+
+	bool is_end_index(const RouteElementID& re, const Index& index) const {
+		(void)re;
+		return index.curr == index.last;
+	}
+
+	Index next_fanout(const RouteElementID& re, const Index& index) const {
+		(void)re;
+		return { std::next(index.curr), index.last };
+	}
+
+	RouteElementID re_from_index(const RouteElementID& re, const Index& out_index) const {
+		(void)re;
+		return util::make_id<RouteElementID>(*out_index.curr);
+	}
+
+	void fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const {
+		append_cached_fanouts(*this, sources, num_sources, out, ends);
+	}
+};
+
 #define ALL_DEVICES_COMMA_SEP \
 	device::Device<device::FanoutPreCachingConnector<device::WiltonConnector>>, \
 	device::Device<device::FanoutPreCachingConnector<device::FullyConnectedConnector>>, \
 	\
+	device::Device<device::FanoutCachingConnector<device::WiltonConnector>>, \
+	device::Device<device::FanoutCachingConnector<device::FullyConnectedConnector>>, \
+	\
+	device::Device<device::FanoutFileCachingConnector<device::WiltonConnector>>, \
+	device::Device<device::FanoutFileCachingConnector<device::FullyConnectedConnector>>, \
+	\
 	device::Device<device::WiltonConnector>, \
 	device::Device<device::FullyConnectedConnector>
 
@@ -600,6 +961,9 @@ namespace DeviceType {
 	static const DeviceTypeID Wilton_PreCached = util::make_id<DeviceTypeID>(5);
 	static const DeviceTypeID FullyConnected_PreCached = util::make_id<DeviceTypeID>(6);
 
+	static const DeviceTypeID Wilton_FileCached = util::make_id<DeviceTypeID>(7);
+	static const DeviceTypeID FullyConnected_FileCached = util::make_id<DeviceTypeID>(8);
+
 	inline boost::optional<DeviceTypeID> parseFromString(const std::string& s) {
 		if (s == "wilton") {
 			return Wilton;
@@ -613,6 +977,10 @@ namespace DeviceType {
 			return Wilton_PreCached;
 		} else if (s == "fc-precached" || s == "fully_connected-precached") {
 			return FullyConnected_PreCached;
+		} else if (s == "wilton-filecached") {
+			return Wilton_FileCached;
+		} else if (s == "fc-filecached" || s == "fully_connected-filecached") {
+			return FullyConnected_FileCached;
 		} else {
 			return boost::none;
 		}
@@ -7,7 +7,9 @@
 #include <util/generator.hpp>
 #include <util/print_printable.hpp>
 
+#include <cstddef>
 #include <ostream>
+#include <vector>
 
 #include <boost/operators.hpp>
 
@@ -202,6 +204,48 @@ public:
 		);
 	}
 
+	/**
+	 * A contiguous view of the fanout of src, for connectors that store it that
+	 * way. Doesn't exist (SFINAE) for connectors that don't.
+	 */
+	template<typename C = CONNECTOR>
+	auto fanout_span(RouteElementID src) const -> decltype(std::declval<const C&>().fanout_span(src)) {
+		return connector.fanout_span(src);
+	}
+
+	/**
+	 * Appends the fanout of each of the num_sources REs at sources to out, and the
+	 * size of out after each to ends. Doesn't exist for connectors without it.
+	 */
+	template<typename C = CONNECTOR>
+	auto fanout_batch(const RouteElementID* sources, std::size_t num_sources, std::vector<RouteElementID>& out, std::vector<std::size_t>& ends) const
+		-> decltype(std::declval<const C&>().fanout_batch(sources, num_sources, out, ends))
+	{
+		return connector.fanout_batch(sources, num_sources, out, ends);
+	}
+
+	/**
+	 * The connector's dense numbering of route elements, so that graph algorithms can
+	 * keep per-RE state in arrays. Only meaningful for REs that are on the device.
+	 */
+	template<typename C = CONNECTOR>
+	auto num_vertices() const -> decltype(std::declval<const C&>().num_route_elements()) {
+		return connector.num_route_elements();
+	}
+
+	/**
+	 * Whether re is on the device. Pins and wires that aren't have no fanout and no
+	 * index, so anything routing to or from them should check this first.
+	 */
+	bool contains_vertex(RouteElementID re) const {
+		return connector.is_valid_route_element(re);
+	}
+
+	template<typename C = CONNECTOR>
+	auto index_of(RouteElementID re) const -> decltype(std::declval<const C&>().route_element_index(re)) {
+		return connector.route_element_index(re);
+	}
+
 	auto fanout(BlockID block) const {
 		const auto begin_it = connector.block_fanout_begin(block);
 		return util::make_generator<std::decay_t<decltype(begin_it)>>(
@@ -0,0 +1,239 @@
+#ifndef DEVICE__RR_GRAPH_FILE_H
+#define DEVICE__RR_GRAPH_FILE_H
+
+#include <device/device.hpp>
+#include <util/logging.hpp>
+#include <util/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace device {
+
+/**
+ * A flat, versioned, on-disk form of a device's routing-resource graph, meant
+ * to be mmap'ed and used in place.
+ *
+ * Layout (all native-endian):
+ *   Header
+ *   std::uint64_t offsets[num_route_elements + 1] -- into edges, indexed by dense RE index
+ *   std::uint64_t edges[num_edges]                -- RouteElementID values
+ */
+namespace rr_graph_file {
+
+static const std::uint32_t FORMAT_VERSION = 1;
+static const char MAGIC[8] = { 'R', 'R', 'G', 'R', 'A', 'P', 'H', '\0' };
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::int32_t device_type;
+	std::int32_t minx, miny, maxx, maxy;
+	std::int32_t track_width;
+	std::int32_t pins_per_block_side;
+	std::int32_t num_blocks_adjacent_to_channel;
+	std::int32_t unused_padding;
+	std::uint64_t num_route_elements;
+	std::uint64_t num_edges;
+};
+static_assert(sizeof(Header) % sizeof(std::uint64_t) == 0, "offsets following the header must stay aligned");
+
+/**
+ * A view of a graph image, and whatever is keeping its memory alive (a mapping or a buffer)
+ */
+struct View {
+	std::shared_ptr<const char> storage;
+	const std::uint64_t* offsets;
+	const std::uint64_t* edges;
+};
+
+/**
+ * Where graph files are read from and written to. If empty, graphs are kept
+ * in memory only. Set from the command line.
+ */
+inline std::string& cacheDirectory() {
+	static std::string directory;
+	return directory;
+}
+
+inline Header makeHeader(const DeviceInfo& dev_info, std::uint64_t num_route_elements, std::uint64_t num_edges) {
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::copy(std::begin(MAGIC), std::end(MAGIC), std::begin(header.magic));
+	header.version = FORMAT_VERSION;
+	header.device_type = dev_info.type().getValue();
+	header.minx = dev_info.bounds.minx();
+	header.miny = dev_info.bounds.miny();
+	header.maxx = dev_info.bounds.maxx();
+	header.maxy = dev_info.bounds.maxy();
+	header.track_width = dev_info.track_width;
+	header.pins_per_block_side = dev_info.pins_per_block_side;
+	header.num_blocks_adjacent_to_channel = dev_info.num_blocks_adjacent_to_channel;
+	header.num_route_elements = num_route_elements;
+	header.num_edges = num_edges;
+	return header;
+}
+
+/**
+ * The name of the file for a graph is unique to everything that affects its contents
+ */
+inline std::string fileNameFor(const DeviceInfo& dev_info) {
+	std::ostringstream name;
+	name << "rr-graph"
+		<< "_t" << dev_info.type().getValue()
+		<< "_b" << dev_info.bounds.minx() << '.' << dev_info.bounds.miny() << '.' << dev_info.bounds.maxx() << '.' << dev_info.bounds.maxy()
+		<< "_w" << dev_info.track_width
+		<< "_p" << dev_info.pins_per_block_side
+		<< "_a" << dev_info.num_blocks_adjacent_to_channel
+		<< ".v" << FORMAT_VERSION
+		<< ".bin"
+	;
+	return name.str();
+}
+
+/**
+ * Serialize the fanout of every RE. fanouts[i] is the fanout of the RE with dense index i
+ */
+template<typename Fanouts>
+std::vector<char> makeImage(const DeviceInfo& dev_info, const Fanouts& fanouts) {
+	std::uint64_t num_edges = 0;
+	for (const auto& fanout : fanouts) {
+		num_edges += fanout.size();
+	}
+
+	const auto header = makeHeader(dev_info, fanouts.size(), num_edges);
+	std::vector<char> image(sizeof(Header) + sizeof(std::uint64_t)*(fanouts.size() + 1 + num_edges));
+	std::memcpy(image.data(), &header, sizeof(header));
+
+	auto offsets = reinterpret_cast<std::uint64_t*>(image.data() + sizeof(Header));
+	auto edges = offsets + fanouts.size() + 1;
+	std::uint64_t offset = 0;
+	for (const auto& fanout : fanouts) {
+		*offsets++ = offset;
+		for (const auto& re : fanout) {
+			edges[offset++] = re.getValue();
+		}
+	}
+	*offsets = offset;
+
+	return image;
+}
+
+/**
+ * Interpret the image, if it really is the graph described by `expected` (num_edges is ignored)
+ */
+inline boost::optional<View> viewOf(std::shared_ptr<const char> storage, std::size_t size, const Header& expected) {
+	if (size < sizeof(Header)) {
+		return boost::none;
+	}
+
+	Header found;
+	std::memcpy(&found, storage.get(), sizeof(found));
+	auto expected_but_with_found_num_edges = expected;
+	expected_but_with_found_num_edges.num_edges = found.num_edges;
+	if (std::memcmp(&found, &expected_but_with_found_num_edges, sizeof(Header)) != 0) {
+		return boost::none;
+	}
+
+	if (size != sizeof(Header) + sizeof(std::uint64_t)*(found.num_route_elements + 1 + found.num_edges)) {
+		return boost::none;
+	}
+
+	const auto offsets = reinterpret_cast<const std::uint64_t*>(storage.get() + sizeof(Header));
+	return View{ storage, offsets, offsets + found.num_route_elements + 1 };
+}
+
+/**
+ * Is everything in the view something that can be used without further checks: do the
+ * offsets describe num_route_elements ranges that exactly cover the edges, and is every
+ * edge a route element that is_valid_route_element accepts?
+ */
+template<typename IsValidRouteElement>
+bool contentsAreValid(const View& view, std::uint64_t num_route_elements, std::uint64_t num_edges, IsValidRouteElement&& is_valid_route_element) {
+	if (view.offsets[0] != 0 || view.offsets[num_route_elements] != num_edges) {
+		return false;
+	}
+	for (std::uint64_t i = 0; i < num_route_elements; ++i) {
+		if (view.offsets[i] > view.offsets[i + 1]) {
+			return false;
+		}
+	}
+	return std::all_of(view.edges, view.edges + num_edges, [&](std::uint64_t edge) {
+		return is_valid_route_element(util::make_id<RouteElementID>(edge));
+	});
+}
+
+/**
+ * Map the file, if it's there and holds a valid image of the graph described by `expected`.
+ * Its contents are checked once here, as the file may have come from anywhere.
+ */
+template<typename IsValidRouteElement>
+boost::optional<View> tryMapFile(const std::string& file_name, const Header& expected, IsValidRouteElement&& is_valid_route_element) {
+	std::shared_ptr<const util::MappedFile> mapped_file;
+	try {
+		mapped_file = std::make_shared<const util::MappedFile>(file_name, DL::DATA_READ1);
+	} catch (const std::runtime_error&) {
+		return boost::none; // not there yet, or unreadable - either way, it'll be (re)made
+	}
+
+	const auto view = viewOf(std::shared_ptr<const char>(mapped_file, mapped_file->data()), mapped_file->size(), expected);
+	if (!view) {
+		return boost::none;
+	}
+
+	Header found;
+	std::memcpy(&found, mapped_file->data(), sizeof(found));
+	if (!contentsAreValid(*view, found.num_route_elements, found.num_edges, is_valid_route_element)) {
+		dout(DL::WARN) << "the routing graph in " << file_name << " is corrupt. Ignoring it\n";
+		return boost::none;
+	}
+
+	return view;
+}
+
+/**
+ * Get the graph for this device from the cache directory, or if it isn't there (or is stale
+ * or corrupt) build it by calling make_fanouts, and store it for next time.
+ * Edges read from a file must pass is_valid_route_element.
+ */
+template<typename IsValidRouteElement, typename MakeFanouts>
+View loadOrMake(const DeviceInfo& dev_info, std::uint64_t num_route_elements, const std::string& cache_directory, IsValidRouteElement&& is_valid_route_element, MakeFanouts&& make_fanouts) {
+	const auto expected = makeHeader(dev_info, num_route_elements, 0);
+	const auto file_name = cache_directory + '/' + fileNameFor(dev_info);
+
+	if (!cache_directory.empty()) {
+		auto view = tryMapFile(file_name, expected, is_valid_route_element);
+		if (view) {
+			dout(DL::INFO) << "using routing graph from " << file_name << '\n';
+			return *view;
+		}
+	}
+
+	auto image = std::make_shared<std::vector<char>>(makeImage(dev_info, make_fanouts()));
+
+	if (!cache_directory.empty()) {
+		dout(DL::INFO) << "writing routing graph to " << file_name << '\n';
+		util::write_file_atomically(file_name, image->data(), image->size());
+		auto view = tryMapFile(file_name, expected, is_valid_route_element);
+		if (view) {
+			return *view; // prefer the mapping, so other processes can share the pages
+		}
+	}
+
+	const auto image_size = image->size();
+	return *viewOf(std::shared_ptr<const char>(image, image->data()), image_size, expected);
+}
+
+} // end namespace rr_graph_file
+
+} // end namespace device
+
+#endif // DEVICE__RR_GRAPH_FILE_H
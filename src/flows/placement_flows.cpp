@@ -3,6 +3,8 @@
 #include <algo/analytic_placement.hpp>
 #include <flows/flows_common.hpp>
 #include <graphics/graphics_wrapper_fpga.hpp>
+#include <util/flat_hash.hpp>
+#include <util/memory_usage.hpp>
 
 #include <array>
 
@@ -295,7 +297,7 @@ struct CliqueAndSpreadFLow : public APLFlowBase<CliqueAndSpreadFLow<Device, Fixe
 				moveable_atom_locations
 			);
 
-			std::unordered_map<BlockID, int> block_usage;
+			util::FlatHashMap<BlockID, int> block_usage;
 			for (const auto& block_and_atom : legalization.atoms_mapped_to_blocks) {
 				block_usage[block_and_atom.first] += 1;
 			}
@@ -375,7 +377,7 @@ struct CliqueAndSpreadFLow : public APLFlowBase<CliqueAndSpreadFLow<Device, Fixe
 			false
 		);
 
-		std::unordered_map<BlockID, int> block_usage;
+		util::FlatHashMap<BlockID, int> block_usage;
 		for (const auto& block_and_atom : final_legalization.atoms_mapped_to_blocks) {
 			block_usage[block_and_atom.first] += 1;
 		}
@@ -775,7 +777,7 @@ struct LegalizationFlow : public FlowBase<LegalizationFlow<Device, FixedBlockLoc
 } // end anon namespace
 
 device::PlacementDevice make_default_device_description(const std::vector<std::vector<device::AtomID>>& net_members) {
-	std::unordered_set<device::AtomID> unique_atoms;
+	util::FlatHashSet<device::AtomID> unique_atoms;
 	for (const auto& net : net_members) {
 		for (const auto& atom : net) {
 			unique_atoms.insert(atom);
@@ -790,6 +792,7 @@ void simple_clique_solve(
 	const std::unordered_map<device::AtomID, device::BlockID>& fixed_block_locations,
 	const device::PlacementDevice& device
 ) {
+	const util::PeakRSSReporter peak_rss_reporter("simple clique solve");
 	SimpleCliqueSolveFlow<std::decay_t<decltype(device)>, std::decay_t<decltype(fixed_block_locations)>>(
 		device,
 		fixed_block_locations,
@@ -806,6 +809,7 @@ void clique_and_spread(
 	const device::PlacementDevice& device,
 	int max_spreadings
 ) {
+	const util::PeakRSSReporter peak_rss_reporter("clique and spread");
 	CliqueAndSpreadFLow<std::decay_t<decltype(device)>, std::decay_t<decltype(fixed_block_locations)>>(
 		device,
 		fixed_block_locations,
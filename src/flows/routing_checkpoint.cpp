@@ -0,0 +1,245 @@
+#include "routing_checkpoint.hpp"
+
+#include <util/logging.hpp>
+#include <util/mapped_file.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace flows {
+
+namespace {
+	static const std::uint32_t FORMAT_VERSION = 1;
+	static const char MAGIC[8] = { 'R', 'T', 'C', 'H', 'K', 'P', 'T', '\0' };
+
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t unused_padding;
+		std::uint64_t input_hash;
+	};
+
+	class Writer {
+	public:
+		template<typename T>
+		void value(const T& t) {
+			static_assert(std::is_trivially_copyable<T>::value, "can only write plain values");
+			const auto as_chars = reinterpret_cast<const char*>(&t);
+			buffer.insert(end(buffer), as_chars, as_chars + sizeof(T));
+		}
+
+		void optional(const boost::optional<int>& opt) {
+			value<std::int32_t>(opt ? 1 : 0);
+			value<std::int32_t>(opt ? *opt : 0);
+		}
+
+		template<typename Netlist>
+		void netlist(const Netlist& netlist) {
+			std::uint64_t num_connections = 0;
+			for (const auto& source : netlist.all_ids()) {
+				for (const auto& sink : netlist.fanout(source)) {
+					(void)sink;
+					num_connections += 1;
+				}
+			}
+			value(num_connections);
+			for (const auto& source : netlist.all_ids()) {
+				for (const auto& sink : netlist.fanout(source)) {
+					value(source.getValue());
+					value(sink.getValue());
+				}
+			}
+		}
+
+		const std::vector<char>& data() const { return buffer; }
+
+	private:
+		std::vector<char> buffer = {};
+	};
+
+	class Reader {
+	public:
+		Reader(const std::string& file_name, const char* begin, const char* end)
+			: file_name(file_name)
+			, curr(begin)
+			, last(end)
+		{ }
+
+		template<typename T>
+		T value() {
+			if (static_cast<std::size_t>(last - curr) < sizeof(T)) {
+				util::print_and_throw<std::runtime_error>([&](auto&& str) {
+					str << "checkpoint " << file_name << " is truncated";
+				});
+			}
+			T t;
+			std::memcpy(&t, curr, sizeof(T));
+			curr += sizeof(T);
+			return t;
+		}
+
+		boost::optional<int> optional() {
+			const auto has_value = value<std::int32_t>();
+			const auto the_value = value<std::int32_t>();
+			return has_value ? boost::optional<int>(the_value) : boost::none;
+		}
+
+		template<typename ID, typename Netlist>
+		void netlist(Netlist& netlist) {
+			const auto num_connections = value<std::uint64_t>();
+			for (std::uint64_t i = 0; i < num_connections; ++i) {
+				const auto source = util::make_id<ID>(value<std::uint64_t>());
+				const auto sink = util::make_id<ID>(value<std::uint64_t>());
+				netlist.addConnection(source, sink);
+			}
+		}
+
+		bool at_end() const { return curr == last; }
+
+	private:
+		const std::string& file_name;
+		const char* curr;
+		const char* const last;
+	};
+
+	std::uint64_t hash_combine(std::uint64_t hash, std::uint64_t value) {
+		// FNV-1a, a byte at a time
+		for (int ibyte = 0; ibyte < 8; ++ibyte) {
+			hash ^= (value >> (ibyte*8)) & 0xFF;
+			hash *= 0x100000001b3;
+		}
+		return hash;
+	}
+}
+
+std::pair<int, boost::optional<int>> RoutingCheckpoint::trackWidthBounds() const {
+	int lower_bound = 1;
+	boost::optional<int> upper_bound;
+	for (const auto& track_width_and_status : attempt_statuses) {
+		if (track_width_and_status.second) {
+			if (!upper_bound || track_width_and_status.first < *upper_bound) {
+				upper_bound = track_width_and_status.first;
+			}
+		} else {
+			lower_bound = std::max(lower_bound, track_width_and_status.first + 1);
+		}
+	}
+	return {lower_bound, upper_bound};
+}
+
+RoutingCheckpointer::RoutingCheckpointer(std::string file_name_, std::uint64_t input_hash, bool resume)
+	: file_name(std::move(file_name_))
+	, input_hash(input_hash)
+	, m_state()
+{
+	if (!resume) {
+		return;
+	}
+
+	if (!std::ifstream(file_name).good()) {
+		dout(DL::INFO) << "no checkpoint at " << file_name << " yet, so starting from the beginning\n";
+		return;
+	}
+
+	const util::MappedFile mapped_file(file_name);
+	Reader reader(file_name, mapped_file.data(), mapped_file.data() + mapped_file.size());
+
+	const auto header = reader.value<Header>();
+	if (!std::equal(std::begin(MAGIC), std::end(MAGIC), std::begin(header.magic)) || header.version != FORMAT_VERSION) {
+		util::print_and_throw<std::runtime_error>([&](auto&& str) {
+			str << file_name << " isn't a (version " << FORMAT_VERSION << ") routing checkpoint";
+		});
+	}
+	if (header.input_hash != input_hash) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "checkpoint " << file_name << " was made for a different circuit or device";
+		});
+	}
+
+	const auto num_attempts = reader.value<std::uint64_t>();
+	for (std::uint64_t i = 0; i < num_attempts; ++i) {
+		const auto track_width = reader.value<std::int32_t>();
+		m_state.attempt_statuses[track_width] = reader.value<std::int32_t>() != 0;
+	}
+
+	m_state.in_progress_track_width = reader.optional();
+	const auto num_in_net_order = reader.value<std::uint64_t>();
+	for (std::uint64_t i = 0; i < num_in_net_order; ++i) {
+		m_state.net_order.push_back(util::make_id<device::PinGID>(reader.value<std::uint64_t>()));
+	}
+
+	m_state.best_track_width = reader.optional();
+	reader.netlist<device::RouteElementID>(m_state.best_result.netlist());
+	reader.netlist<device::PinGID>(m_state.best_result.unroutedPins());
+	m_state.best_result.routeStats().num_explored = reader.value<std::uint64_t>();
+
+	if (!reader.at_end()) {
+		util::print_and_throw<std::runtime_error>([&](auto&& str) {
+			str << "checkpoint " << file_name << " has extra data at the end";
+		});
+	}
+
+	const auto bounds = m_state.trackWidthBounds();
+	dout(DL::INFO) << "resuming from " << file_name << ": " << m_state.attempt_statuses.size() << " track widths already tried, smallest routable is at least " << bounds.first;
+	if (bounds.second) {
+		dout(DL::INFO) << " and at most " << *bounds.second;
+	}
+	dout(DL::INFO) << '\n';
+}
+
+void RoutingCheckpointer::save() const {
+	Writer writer;
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::copy(std::begin(MAGIC), std::end(MAGIC), std::begin(header.magic));
+	header.version = FORMAT_VERSION;
+	header.input_hash = input_hash;
+	writer.value(header);
+
+	writer.value(static_cast<std::uint64_t>(m_state.attempt_statuses.size()));
+	for (const auto& track_width_and_status : m_state.attempt_statuses) {
+		writer.value<std::int32_t>(track_width_and_status.first);
+		writer.value<std::int32_t>(track_width_and_status.second ? 1 : 0);
+	}
+
+	writer.optional(m_state.in_progress_track_width);
+	writer.value(static_cast<std::uint64_t>(m_state.net_order.size()));
+	for (const auto& pin : m_state.net_order) {
+		writer.value(pin.getValue());
+	}
+
+	writer.optional(m_state.best_track_width);
+	writer.netlist(m_state.best_result.netlist());
+	writer.netlist(m_state.best_result.unroutedPins());
+	writer.value(static_cast<std::uint64_t>(m_state.best_result.routeStats().num_explored));
+
+	util::write_file_atomically(file_name, writer.data().data(), writer.data().size());
+}
+
+std::uint64_t hash_routing_input(
+	const device::DeviceInfo& dev_info,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& pin_order
+) {
+	std::uint64_t hash = 0xcbf29ce484222325;
+	for (const auto& value : {
+		dev_info.type().getValue(),
+		dev_info.bounds.minx(), dev_info.bounds.miny(), dev_info.bounds.maxx(), dev_info.bounds.maxy(),
+		dev_info.track_width,
+		dev_info.pins_per_block_side,
+		dev_info.num_blocks_adjacent_to_channel,
+	}) {
+		hash = hash_combine(hash, static_cast<std::uint64_t>(value));
+	}
+
+	for (const auto& source_and_sink : pin_order) {
+		hash = hash_combine(hash, source_and_sink.first.getValue());
+		hash = hash_combine(hash, source_and_sink.second.getValue());
+	}
+
+	return hash;
+}
+
+} // end namespace flows
@@ -0,0 +1,81 @@
+#ifndef FLOWS__ROUTING_CHECKPOINT_H
+#define FLOWS__ROUTING_CHECKPOINT_H
+
+#include <algo/routing.hpp>
+#include <device/device.hpp>
+#include <util/netlist.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace flows {
+
+/**
+ * Everything the track width exploration needs to pick up where it left off.
+ */
+struct RoutingCheckpoint {
+	using Result = algo::RouteAllResult<util::Netlist<device::PinGID>>;
+
+	std::map<int, bool> attempt_statuses = {}; // track width -> did it route
+
+	// the track width the retry loop is in the middle of, and the sources it has decided to route first there
+	boost::optional<int> in_progress_track_width = boost::none;
+	std::vector<device::PinGID> net_order = {};
+
+	// the routing for the smallest track width that has routed so far
+	boost::optional<int> best_track_width = boost::none;
+	Result best_result = {};
+
+	/**
+	 * The smallest routable track width is above every width that failed, and
+	 * at most the smallest one that routed (if there is one)
+	 */
+	std::pair<int, boost::optional<int>> trackWidthBounds() const;
+};
+
+/**
+ * Owns a RoutingCheckpoint, and writes it out to a file (atomically) when asked.
+ *
+ * File format (all native-endian): a header with a magic number, version and the
+ * hash of the input it was made for, then each member of RoutingCheckpoint in order.
+ * Sequences are a std::uint64_t count followed by the elements, and netlists are
+ * stored as sequences of (source, sink) ID values.
+ */
+class RoutingCheckpointer {
+public:
+	/**
+	 * If resume is set and file_name exists, starts from what's in it. Throws if
+	 * that file isn't a checkpoint, or was made for a different input_hash.
+	 */
+	RoutingCheckpointer(std::string file_name, std::uint64_t input_hash, bool resume);
+
+	RoutingCheckpointer(const RoutingCheckpointer&) = delete;
+	RoutingCheckpointer& operator=(const RoutingCheckpointer&) = delete;
+
+	RoutingCheckpoint& state() { return m_state; }
+	const RoutingCheckpoint& state() const { return m_state; }
+
+	void save() const;
+
+private:
+	std::string file_name;
+	std::uint64_t input_hash;
+	RoutingCheckpoint m_state;
+};
+
+/**
+ * Identifies a device and circuit, so that a checkpoint isn't resumed against a different one
+ */
+std::uint64_t hash_routing_input(
+	const device::DeviceInfo& dev_info,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& pin_order
+);
+
+} // end namespace flows
+
+#endif // FLOWS__ROUTING_CHECKPOINT_H
@@ -1,17 +1,117 @@
 #include "routing_flows.hpp"
 
+#include <algo/incremental_routing.hpp>
+#include <algo/route_verifier.hpp>
 #include <algo/routing.hpp>
 #include <flows/flows_common.hpp>
+#include <flows/routing_checkpoint.hpp>
 #include <graphics/graphics_wrapper_fpga.hpp>
 #include <util/lambda_compose.hpp>
 #include <util/logging.hpp>
+#include <util/memory_usage.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 #include <boost/range/irange.hpp>
 
 namespace flows {
 
+namespace {
+	std::size_t& max_warm_devices() {
+		static std::size_t max_devices = 0;
+		return max_devices;
+	}
+
+	auto warm_device_key(const device::DeviceInfo& dev_info) {
+		return std::make_tuple(
+			dev_info.type().getValue(),
+			dev_info.bounds.minx(), dev_info.bounds.miny(), dev_info.bounds.maxx(), dev_info.bounds.maxy(),
+			dev_info.track_width,
+			dev_info.pins_per_block_side,
+			dev_info.num_blocks_adjacent_to_channel
+		);
+	}
+
+	/**
+	 * A device for dev_info - the same one as last time if devices are being kept warm
+	 * and it's one of the most recently asked for. Whoever asks for a device first builds
+	 * it, and anyone else asking for it meanwhile waits for that, but not for other devices.
+	 */
+	template<typename Device>
+	std::shared_ptr<const Device> get_device(const device::DeviceInfo& dev_info) {
+		if (max_warm_devices() == 0) {
+			return std::make_shared<const Device>(dev_info);
+		}
+
+		using Key = decltype(warm_device_key(dev_info));
+		using DeviceFuture = std::shared_future<std::shared_ptr<const Device>>;
+		static std::mutex warm_devices_mutex;
+		static std::list<std::pair<Key, DeviceFuture>> warm_devices; // most recently used first
+
+		const auto key = warm_device_key(dev_info);
+		std::promise<std::shared_ptr<const Device>> to_build;
+		DeviceFuture warm_device;
+		bool build_it = false;
+		{
+			std::lock_guard<std::mutex> warm_devices_lock(warm_devices_mutex);
+			const auto found = std::find_if(begin(warm_devices), end(warm_devices), [&](const auto& key_and_device) {
+				return key_and_device.first == key;
+			});
+			if (found != end(warm_devices)) {
+				dout(DL::INFO) << "reusing already built device\n";
+				warm_devices.splice(begin(warm_devices), warm_devices, found);
+			} else {
+				build_it = true;
+				warm_devices.emplace_front(key, to_build.get_future().share());
+				// eg. the track widths a TrackWidthExploration only tried once
+				while (warm_devices.size() > max_warm_devices()) {
+					warm_devices.pop_back();
+				}
+			}
+			warm_device = warm_devices.front().second;
+		}
+
+		if (build_it) {
+			try {
+				to_build.set_value(std::make_shared<const Device>(dev_info));
+			} catch (...) {
+				to_build.set_exception(std::current_exception()); // for anyone already waiting
+				std::lock_guard<std::mutex> warm_devices_lock(warm_devices_mutex);
+				warm_devices.remove_if([&](const auto& key_and_device) { return key_and_device.first == key; }); // but try again next time
+			}
+		}
+		return warm_device.get();
+	}
+
+	/**
+	 * Throw if there's anything wrong with the routing, after saying what. The flows do this once,
+	 * on the routing they hand back, rather than after every pass.
+	 */
+	template<typename Result, typename Device>
+	void verify_or_throw(const Result& result, const util::Netlist<device::PinGID>& pin_to_pin_netlist, const Device& dev, int nThreads) {
+		const auto violations = algo::verify_routing(result, pin_to_pin_netlist, dev, nThreads);
+		if (!violations.empty()) {
+			for (const auto& violation : violations) {
+				dout(DL::INFO) << "routing violation: " << violation << '\n';
+			}
+			util::print_and_throw<std::runtime_error>([&](auto&& str) {
+				str << "routing result failed verification with " << violations.size() << " violations";
+			});
+		}
+	}
+}
+
+void keep_devices_warm(std::size_t max_devices) {
+	max_warm_devices() = max_devices;
+}
+
 template<typename Device>
 class FanoutTestFlow : public FlowBase<FanoutTestFlow<Device>, Device> {
 public:
@@ -91,7 +191,7 @@ public:
 		}
 
 		if (present_graphics) {
-			const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, result.netlist());
+			const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, nullptr, result.netlistSnapshot(), nullptr);
 			graphics::get().waitForPress();
 		}
 
@@ -107,10 +207,18 @@ public:
 	RouteWithRetryFlow(const RouteWithRetryFlow&) = default;
 	RouteWithRetryFlow(RouteWithRetryFlow&&) = default;
 
+	/**
+	 * Returns the last attempt, which routed everything unless it gave up.
+	 * If there is a checkpointer, the sources to route first are kept in it
+	 * as they're found, and picked up from there if it was in the middle of this track width.
+	 * The search stats of every attempt are added to route_stats, if given.
+	 */
 	template<typename PinOrder>
-	bool flow_main(
+	auto flow_main(
 		const util::Netlist<device::PinGID>& pin_to_pin_netlist,
-		const PinOrder& base_pin_order
+		const PinOrder& base_pin_order,
+		RoutingCheckpointer* checkpointer = nullptr,
+		algo::MazeRouteStats* route_stats = nullptr
 	) const {
 		const auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
 			str << "RouteWithRetry Flow";
@@ -119,6 +227,20 @@ public:
 		std::unordered_set<device::PinGID> in_route_these_sources_first;
 		std::list<device::PinGID> route_these_sources_first;
 
+		if (checkpointer) {
+			auto& state = checkpointer->state();
+			if (state.in_progress_track_width && *state.in_progress_track_width == dev.info().track_width) {
+				for (const auto& source : state.net_order) {
+					route_these_sources_first.push_back(source);
+					in_route_these_sources_first.insert(source);
+				}
+				dout(DL::INFO) << "resuming with " << route_these_sources_first.size() << " sources routed first\n";
+			} else {
+				state.in_progress_track_width = dev.info().track_width;
+				state.net_order.clear();
+			}
+		}
+
 		while (true) {
 			std::vector<device::PinGID> source_order;
 			std::copy(begin(route_these_sources_first), end(route_these_sources_first), std::back_inserter(source_order));
@@ -128,7 +250,10 @@ public:
 					source_order.push_back(source);
 				}
 			}
-			const auto result = RouteAsIsFlow<Device>(*this).flow_main(pin_to_pin_netlist, source_order, false);
+			auto result = RouteAsIsFlow<Device>(*this).flow_main(pin_to_pin_netlist, source_order, false);
+			if (route_stats) {
+				*route_stats += result.routeStats();
+			}
 
 			bool added_something = false;
 			for (const auto& source : result.unroutedPins().all_ids()) {
@@ -142,16 +267,20 @@ public:
 				}
 			}
 
+			if (checkpointer && added_something) {
+				checkpointer->state().net_order.assign(begin(route_these_sources_first), end(route_these_sources_first));
+				checkpointer->save();
+			}
 
 			if (result.unroutedPins().empty()) {
-				const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, result.netlist());
+				const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, nullptr, result.netlistSnapshot(), nullptr);
 				graphics::get().waitForPress();
-				return true;
+				return result;
 			} else if (!added_something) {
 				dout(DL::INFO) << "Failed to route the same nets. Giving up.\n";
-				const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, result.netlist());
+				const auto gfx_state_keeper_final_routes = graphics::get().fpga().pushRoutingState(&dev, nullptr, result.netlistSnapshot(), nullptr);
 				graphics::get().waitForPress();
-				return false;
+				return result;
 			}
 		}
 	}
@@ -165,15 +294,24 @@ public:
 	TrackWidthExplorationFlow(const TrackWidthExplorationFlow&) = default;
 	TrackWidthExplorationFlow(TrackWidthExplorationFlow&&) = default;
 
-	void flow_main(
+	/**
+	 * If there is a checkpointer, it is saved after every routing attempt, and
+	 * any track widths already tried in it are not tried again.
+	 */
+	boost::optional<int> flow_main(
 		const util::Netlist<device::PinGID>& pin_to_pin_netlist,
-		const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order
+		const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
+		RoutingCheckpointer* checkpointer = nullptr,
+		algo::MazeRouteStats* route_stats = nullptr
 	) const {
 		const auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
 			str << "TrackWidthExploration Flow";
 		});
 
-		std::unordered_map<int, bool> attempt_statuses;
+		RoutingCheckpoint checkpoint_if_not_saving;
+		auto& state = checkpointer ? checkpointer->state() : checkpoint_if_not_saving;
+		std::shared_ptr<const Device> best_device; // state.best_result's, if it was routed by this call
+		auto& attempt_statuses = state.attempt_statuses;
 		auto track_width_range = boost::irange(1, dev.info().track_width+1); // +1 as last argument is a past-end
 		const auto SENTINEL = -1; // something note in the above range, specifically less than everything
 		using std::begin; using std::end;
@@ -189,11 +327,13 @@ public:
 					});
 
 					auto indent = dout(DL::INFO).indentWithTitle("Creating New Device");
-					const Device modified_dev(dev_info_copy);
+					const auto modified_dev_ptr = get_device<Device>(dev_info_copy);
+					const auto& modified_dev = *modified_dev_ptr;
 					dout(DL::INFO) << "done creating new device\n";
 					indent.endIndent();
 
-					const auto route_success = RouteWithRetryFlow<Device>(*this).withDevice(modified_dev).flow_main(pin_to_pin_netlist, base_pin_order);
+					auto result = RouteWithRetryFlow<Device>(*this).withDevice(modified_dev).flow_main(pin_to_pin_netlist, base_pin_order, checkpointer, route_stats);
+					const auto route_success = result.unroutedPins().empty();
 					// const auto route_success = RouteAsIsFlow<Device>(modified_dev).flow_main(pin_to_pin_netlist).unroutedPins().empty();
 
 					if (route_success) {
@@ -201,6 +341,19 @@ public:
 					} else {
 						dout(DL::INFO) << "Circuit FAILED to route with track width of " << modified_dev.info().track_width << '\n';
 					}
+
+					if (route_success && (!state.best_track_width || dev_info_copy.track_width < *state.best_track_width)) {
+						state.best_track_width = dev_info_copy.track_width;
+						state.best_result = std::move(result);
+						best_device = modified_dev_ptr;
+					}
+					state.in_progress_track_width = boost::none;
+					state.net_order.clear();
+					attempt_statuses[dev_info_copy.track_width] = route_success;
+					if (checkpointer) {
+						checkpointer->save();
+					}
+
 					return route_success;
 				} else {
 					const auto route_success = attempt_find_result->second;
@@ -222,11 +375,29 @@ public:
 				return !route_success;
 			}
 		});
+
+		// only the routing that's kept is checked - not every attempt on the way to it
+		if (state.best_track_width) {
+			if (!best_device) {
+				auto dev_info_copy = this->dev.info();
+				dev_info_copy.track_width = *state.best_track_width;
+				best_device = get_device<Device>(dev_info_copy);
+			}
+			verify_or_throw(state.best_result, pin_to_pin_netlist, *best_device, nThreads);
+		}
+
+		boost::optional<int> smallest_routable_track_width;
+		for (const auto& track_width_and_status : attempt_statuses) {
+			if (track_width_and_status.second && (!smallest_routable_track_width || track_width_and_status.first < *smallest_routable_track_width)) {
+				smallest_routable_track_width = track_width_and_status.first;
+			}
+		}
+		return smallest_routable_track_width;
 	}
 };
 
 namespace {
-	using DeviceVariant = boost::variant<ALL_DEVICES_COMMA_SEP>;
+	using DeviceVariant = util::substitute_into<boost::variant, util::shared_ptr_to_const_t, ALL_DEVICES_COMMA_SEP>;
 
 	DeviceVariant make_device(const device::DeviceInfo& dev_desc) {
 		auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
@@ -236,22 +407,28 @@ namespace {
 		const auto& dtype = dev_desc.type();
 
 		if (dtype == device::DeviceType::Wilton) {
-			return device::Device<device::WiltonConnector>(dev_desc);
+			return get_device<device::Device<device::WiltonConnector>>(dev_desc);
 
 		} else if (dtype == device::DeviceType::FullyConnected) {
-			return device::Device<device::FullyConnectedConnector>(dev_desc);
+			return get_device<device::Device<device::FullyConnectedConnector>>(dev_desc);
 
-		// } else if (dtype == device::DeviceType::Wilton_Cached) {
-		// 	return device::Device<device::FanoutCachingConnector<device::WiltonConnector>>(dev_desc);
+		} else if (dtype == device::DeviceType::Wilton_Cached) {
+			return get_device<device::Device<device::FanoutCachingConnector<device::WiltonConnector>>>(dev_desc);
 
-		// } else if (dtype == device::DeviceType::FullyConnected_Cached) {
-		// 	return device::Device<device::FanoutCachingConnector<device::FullyConnectedConnector>>(dev_desc);
+		} else if (dtype == device::DeviceType::FullyConnected_Cached) {
+			return get_device<device::Device<device::FanoutCachingConnector<device::FullyConnectedConnector>>>(dev_desc);
 
 		} else if (dtype == device::DeviceType::Wilton_PreCached) {
-			return device::Device<device::FanoutPreCachingConnector<device::WiltonConnector>>(dev_desc);
+			return get_device<device::Device<device::FanoutPreCachingConnector<device::WiltonConnector>>>(dev_desc);
 
 		} else if (dtype == device::DeviceType::FullyConnected_PreCached) {
-			return device::Device<device::FanoutPreCachingConnector<device::FullyConnectedConnector>>(dev_desc);
+			return get_device<device::Device<device::FanoutPreCachingConnector<device::FullyConnectedConnector>>>(dev_desc);
+
+		} else if (dtype == device::DeviceType::Wilton_FileCached) {
+			return get_device<device::Device<device::FanoutFileCachingConnector<device::WiltonConnector>>>(dev_desc);
+
+		} else if (dtype == device::DeviceType::FullyConnected_FileCached) {
+			return get_device<device::Device<device::FanoutFileCachingConnector<device::FullyConnectedConnector>>>(dev_desc);
 
 		} else {
 			util::print_and_throw<std::runtime_error>([&](auto&& str) {
@@ -266,40 +443,145 @@ void fanout_test(
 	const device::DeviceInfo& dev_desc,
 	int nThreads
 ) {
+	const util::PeakRSSReporter peak_rss_reporter("fanout test");
 	auto device_variant = make_device(dev_desc);
 	apply_visitor(util::compose_withbase<boost::static_visitor<void>>([&](auto&& device) {
-		FanoutTestFlow<std::decay_t<decltype(device)>> flow(device, nThreads);
+		FanoutTestFlow<std::decay_t<decltype(*device)>> flow(*device, nThreads);
 		flow.flow_main();
 	}), device_variant);
 }
 
-void track_width_exploration(
+boost::optional<int> track_width_exploration(
 	const device::DeviceInfo& dev_desc,
 	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
 	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
-	int nThreads
+	int nThreads,
+	const std::string& checkpoint_file_name,
+	bool resume,
+	algo::MazeRouteStats* route_stats
 ) {
+	const util::PeakRSSReporter peak_rss_reporter("track width exploration");
+	std::unique_ptr<RoutingCheckpointer> checkpointer;
+	if (!checkpoint_file_name.empty()) {
+		checkpointer = std::make_unique<RoutingCheckpointer>(checkpoint_file_name, hash_routing_input(dev_desc, base_pin_order), resume);
+	}
+
 	auto device_variant = make_device(dev_desc);
-	apply_visitor(util::compose_withbase<boost::static_visitor<void>>([&](auto&& device) {
-		TrackWidthExplorationFlow<std::decay_t<decltype(device)>> flow(device, nThreads);
-		flow.flow_main(pin_to_pin_netlist, base_pin_order);
+	return apply_visitor(util::compose_withbase<boost::static_visitor<boost::optional<int>>>([&](auto&& device) {
+		TrackWidthExplorationFlow<std::decay_t<decltype(*device)>> flow(*device, nThreads);
+		return flow.flow_main(pin_to_pin_netlist, base_pin_order, checkpointer.get(), route_stats);
 	}), device_variant);
 }
 
-void route_as_is(
+RouteOnceStats route_once(
 	const device::DeviceInfo& dev_desc,
 	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
 	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
 	int nThreads
 ) {
 	auto device_variant = make_device(dev_desc);
-	apply_visitor(util::compose_withbase<boost::static_visitor<void>>([&](auto&& device) {
-		RouteAsIsFlow<std::decay_t<decltype(device)>> flow(device, nThreads);
-		flow.flow_main(pin_to_pin_netlist, util::xrange_forward_pe<decltype(begin(base_pin_order))>(
+	return apply_visitor(util::compose_withbase<boost::static_visitor<RouteOnceStats>>([&](auto&& device) {
+		RouteAsIsFlow<std::decay_t<decltype(*device)>> flow(*device, nThreads);
+
+		const auto start_time = std::chrono::steady_clock::now();
+		const auto result = flow.flow_main(pin_to_pin_netlist, util::xrange_forward_pe<decltype(begin(base_pin_order))>(
+			begin(base_pin_order),
+			end(base_pin_order),
+			[](auto& source_and_sink) { return source_and_sink->first; }
+		), false);
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		verify_or_throw(result, pin_to_pin_netlist, *device, nThreads);
+
+		std::size_t num_unrouted_connections = 0;
+		for (const auto& source : result.unroutedPins().all_ids()) {
+			for (const auto& sink : result.unroutedPins().fanout(source)) {
+				(void)sink;
+				num_unrouted_connections += 1;
+			}
+		}
+
+		return RouteOnceStats{
+			num_unrouted_connections == 0,
+			num_unrouted_connections,
+			static_cast<std::size_t>(std::count_if(begin(result.netlist().all_ids()), end(result.netlist().all_ids()), [](const auto& reid) {
+				return !reid.isPin();
+			})),
+			result.routeStats().num_explored,
+			seconds,
+		};
+	}), device_variant);
+}
+
+bool route_eco(
+	const device::DeviceInfo& dev_desc,
+	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
+	const algo::NetlistDelta& delta,
+	int nThreads,
+	algo::MazeRouteStats* route_stats
+) {
+	const util::PeakRSSReporter peak_rss_reporter("ECO routing");
+	auto device_variant = make_device(dev_desc);
+	return apply_visitor(util::compose_withbase<boost::static_visitor<bool>>([&](auto&& device) {
+		using Device = std::decay_t<decltype(*device)>;
+		RouteAsIsFlow<Device> flow(*device, nThreads);
+		auto before = flow.flow_main(pin_to_pin_netlist, util::xrange_forward_pe<decltype(begin(base_pin_order))>(
+			begin(base_pin_order),
+			end(base_pin_order),
+			[](auto& source_and_sink) { return source_and_sink->first; }
+		), false);
+		if (route_stats) {
+			*route_stats += before.routeStats();
+		}
+
+		const auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
+			str << "Incremental Routing ( +" << delta.added.size() << " -" << delta.removed.size() << " connections )";
+		});
+
+		const auto changed_pin_to_pin_netlist = algo::apply_delta(pin_to_pin_netlist, delta);
+		algo::IncrementalRouter<util::Netlist<device::PinGID>, Device> router(std::move(before), *device, nThreads);
+		router.apply(changed_pin_to_pin_netlist, delta);
+		if (route_stats) {
+			*route_stats += router.result().routeStats();
+		}
+
+		for (const auto& source : router.result().unroutedPins().all_ids()) {
+			for (const auto& sink : router.result().unroutedPins().fanout(source)) {
+				dout(DL::INFO) << "failed to route " << source << " -> " << sink << '\n';
+			}
+		}
+
+		const auto gfx_state_keeper = graphics::get().fpga().pushRoutingState(device.get(), nullptr, router.result().netlistSnapshot(), nullptr);
+		graphics::get().waitForPress();
+
+		verify_or_throw(router.result(), changed_pin_to_pin_netlist, *device, nThreads);
+		const auto routed = router.result().unroutedPins().empty();
+		dout(DL::INFO) << "Changed circuit " << (routed ? "successfully routed" : "FAILED to route") << " with track width of " << dev_desc.track_width << '\n';
+		return routed;
+	}), device_variant);
+}
+
+bool route_as_is(
+	const device::DeviceInfo& dev_desc,
+	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
+	int nThreads,
+	algo::MazeRouteStats* route_stats
+) {
+	const util::PeakRSSReporter peak_rss_reporter("routing as-is");
+	auto device_variant = make_device(dev_desc);
+	return apply_visitor(util::compose_withbase<boost::static_visitor<bool>>([&](auto&& device) {
+		RouteAsIsFlow<std::decay_t<decltype(*device)>> flow(*device, nThreads);
+		const auto result = flow.flow_main(pin_to_pin_netlist, util::xrange_forward_pe<decltype(begin(base_pin_order))>(
 			begin(base_pin_order),
 			end(base_pin_order),
 			[](auto& source_and_sink) { return source_and_sink->first; }
 		));
+		verify_or_throw(result, pin_to_pin_netlist, *device, nThreads);
+		if (route_stats) {
+			*route_stats += result.routeStats();
+		}
+		return result.unroutedPins().empty();
 	}), device_variant);
 }
 
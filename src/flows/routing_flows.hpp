@@ -1,29 +1,94 @@
 #ifndef FLOWS__PLACEMENT_FLOWS_H
 #define FLOWS__PLACEMENT_FLOWS_H
 
+#include <algo/incremental_routing.hpp>
+#include <algo/routing.hpp>
 #include <device/connectors.hpp>
 #include <device/device.hpp>
 #include <util/netlist.hpp>
 
+#include <cstddef>
+#include <string>
+
+#include <boost/optional.hpp>
+
 namespace flows {
 
+/**
+ * Keep the max_devices devices of each type that the flows most recently asked for
+ * alive, and hand the same one back when a device with the same DeviceInfo is asked
+ * for again. For running many circuits against a few device configurations, where
+ * building devices (and their fanout caches) would otherwise be paid for every circuit.
+ * The limit is so that every track width a search tries isn't kept. 0 turns this off.
+ */
+void keep_devices_warm(std::size_t max_devices = 8);
+
 void fanout_test(
 	const device::DeviceInfo& dev_desc,
 	int nThreads = 1
 );
 
-void track_width_exploration(
+/**
+ * What happened in a single routing attempt, for comparing configurations
+ */
+struct RouteOnceStats {
+	bool routed;
+	std::size_t num_unrouted_connections;
+	std::size_t num_used_routing_resources;
+	std::size_t num_explored;
+	double seconds; // just the routing, not building the device
+};
+
+/**
+ * Route every connection once, with the device exactly as described
+ */
+RouteOnceStats route_once(
 	const device::DeviceInfo& dev_desc,
 	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
 	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
 	int nThreads = 1
 );
 
-void route_as_is(
+/**
+ * Returns the smallest track width the circuit was found to route with, if any.
+ * If checkpoint_file_name is given, the progress is saved there after every
+ * routing attempt, and if resume is also set, continues from what's already there.
+ * The search stats of every routing attempt are added to route_stats, if given.
+ */
+boost::optional<int> track_width_exploration(
 	const device::DeviceInfo& dev_desc,
 	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
 	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
-	int nThreads = 1
+	int nThreads = 1,
+	const std::string& checkpoint_file_name = "",
+	bool resume = false,
+	algo::MazeRouteStats* route_stats = nullptr
+);
+
+/**
+ * Route the netlist as-is, then apply the engineering change `delta` to it, rerouting
+ * only the nets it touches (and any in their way). See algo::IncrementalRouter.
+ * Returns true if every connection of the changed netlist was routed.
+ * The search stats of both are added to route_stats, if given.
+ */
+bool route_eco(
+	const device::DeviceInfo& dev_desc,
+	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
+	const algo::NetlistDelta& delta,
+	int nThreads = 1,
+	algo::MazeRouteStats* route_stats = nullptr
+);
+
+/**
+ * Returns true if every connection was routed. The search stats are added to route_stats, if given.
+ */
+bool route_as_is(
+	const device::DeviceInfo& dev_desc,
+	const util::Netlist<device::PinGID>& pin_to_pin_netlist,
+	const std::vector<std::pair<device::PinGID, device::PinGID>>& base_pin_order,
+	int nThreads = 1,
+	algo::MazeRouteStats* route_stats = nullptr
 );
 
 } // end namespace flow
@@ -0,0 +1,222 @@
+#include "routing_sweep.hpp"
+
+#include <device/connectors.hpp>
+#include <flows/routing_flows.hpp>
+#include <parsing/routing_input_parser.hpp>
+#include <util/lambda_compose.hpp>
+#include <util/logging.hpp>
+#include <util/memory_usage.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <boost/optional.hpp>
+
+namespace flows {
+
+namespace {
+	int parse_positive_int(const std::string& key, const std::string& str) {
+		std::size_t pos = 0;
+		int result = 0;
+		try {
+			result = std::stoi(str, &pos);
+		} catch (const std::logic_error&) {
+			pos = 0;
+		}
+		if (pos != str.size() || result <= 0) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& s) {
+				s << "sweep grid " << key << " value must be a positive integer, not " << str;
+			});
+		}
+		return result;
+	}
+
+	std::string csv_field(const std::string& str) {
+		if (str.find_first_of(",\"\n") == std::string::npos) {
+			return str;
+		}
+		std::string result = "\"";
+		for (const auto& c : str) {
+			if (c == '"') {
+				result += '"';
+			}
+			result += c;
+		}
+		result += '"';
+		return result;
+	}
+
+	struct SweepRun {
+		const parsing::routing::input::ParseResult* input;
+		std::string data_file;
+		std::string device_type_name;
+		device::DeviceTypeID device_type;
+		boost::optional<int> track_width;
+		int num_threads;
+		int repeat;
+	};
+}
+
+SweepGrid parse_sweep_grid(std::istream& is, int default_num_threads) {
+	SweepGrid grid{ {}, {}, {}, {}, 1 };
+
+	std::string line;
+	while (std::getline(is, line)) {
+		std::istringstream line_stream(line);
+		std::string key;
+		if (!(line_stream >> key) || key.front() == '#') {
+			continue;
+		}
+
+		std::vector<std::string> values;
+		for (std::string value; line_stream >> value;) {
+			values.push_back(value);
+		}
+		if (values.empty()) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& s) {
+				s << "sweep grid " << key << " needs at least one value";
+			});
+		}
+
+		if (key == "data-file") {
+			grid.data_files.insert(end(grid.data_files), begin(values), end(values));
+		} else if (key == "device-type") {
+			for (const auto& value : values) {
+				if (!device::DeviceType::parseFromString(value)) {
+					util::print_and_throw<std::invalid_argument>([&](auto&& s) {
+						s << "sweep grid doesn't understand device-type " << value;
+					});
+				}
+				grid.device_type_names.push_back(value);
+			}
+		} else if (key == "track-width") {
+			for (const auto& value : values) {
+				grid.track_widths.push_back(parse_positive_int(key, value));
+			}
+		} else if (key == "num-threads") {
+			for (const auto& value : values) {
+				grid.thread_counts.push_back(parse_positive_int(key, value));
+			}
+		} else if (key == "repeats" && values.size() == 1) {
+			grid.repeats = parse_positive_int(key, values.front());
+		} else {
+			util::print_and_throw<std::invalid_argument>([&](auto&& s) {
+				s << "don't understand sweep grid line: " << line;
+			});
+		}
+	}
+
+	if (grid.data_files.empty() || grid.device_type_names.empty()) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& s) {
+			s << "a sweep grid needs at least one data-file and device-type";
+		});
+	}
+
+	if (grid.thread_counts.empty()) {
+		grid.thread_counts.push_back(default_num_threads);
+	}
+
+	return grid;
+}
+
+int run_sweep(const SweepGrid& grid, int num_concurrent_runs, std::ostream& csv) {
+	const util::PeakRSSReporter peak_rss_reporter("routing sweep");
+	const auto indent = dout(DL::INFO).indentWithTitle("Routing Sweep");
+
+	keep_devices_warm();
+
+	std::map<std::string, parsing::routing::input::ParseResult> inputs;
+	for (const auto& data_file_name : grid.data_files) {
+		if (inputs.find(data_file_name) != end(inputs)) {
+			continue;
+		}
+
+		auto parse_result = parsing::routing::input::parse_data_file(data_file_name, device::DeviceType::parseFromString(grid.device_type_names.front()));
+		inputs.emplace(data_file_name, apply_visitor(util::compose_withbase<boost::static_visitor<parsing::routing::input::ParseResult>>(
+			[&](const std::string& err_str) -> parsing::routing::input::ParseResult {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << data_file_name << ": " << err_str;
+				});
+			},
+			[&](const parsing::routing::input::ParseResult& pr) {
+				return pr;
+			}
+		), parse_result));
+	}
+
+	std::vector<SweepRun> runs;
+	const auto track_widths = grid.track_widths.empty() ? std::vector<boost::optional<int>>{boost::none} : std::vector<boost::optional<int>>(begin(grid.track_widths), end(grid.track_widths));
+	for (const auto& data_file_name : grid.data_files) {
+		for (const auto& device_type_name : grid.device_type_names) {
+			for (const auto& track_width : track_widths) {
+				for (const auto& num_threads : grid.thread_counts) {
+					for (int repeat = 0; repeat < grid.repeats; ++repeat) {
+						runs.push_back(SweepRun{
+							&inputs.at(data_file_name),
+							data_file_name,
+							device_type_name,
+							*device::DeviceType::parseFromString(device_type_name),
+							track_width,
+							num_threads,
+							repeat,
+						});
+					}
+				}
+			}
+		}
+	}
+
+	dout(DL::INFO) << "doing " << runs.size() << " runs, " << num_concurrent_runs << " at a time\n";
+
+	csv << "run,data_file,device_type,track_width,num_threads,repeat,routed,unrouted_connections,used_routing_resources,explored_nodes,seconds,error\n" << std::flush;
+
+	std::mutex csv_mutex;
+	std::atomic<std::size_t> next_run(0);
+	std::atomic<int> num_failed_runs(0);
+	const auto do_runs = [&]() {
+		while (true) {
+			const auto irun = next_run.fetch_add(1);
+			if (irun >= runs.size()) {
+				return;
+			}
+			const auto& run = runs[irun];
+
+			auto dev_info = run.input->device_info;
+			dev_info.type() = run.device_type;
+			if (run.track_width) {
+				dev_info.track_width = *run.track_width;
+			}
+
+			std::ostringstream row;
+			row << irun << ',' << csv_field(run.data_file) << ',' << run.device_type_name << ',' << dev_info.track_width << ',' << run.num_threads << ',' << run.repeat << ',';
+			try {
+				const auto stats = route_once(dev_info, run.input->pin_to_pin_netlist, run.input->pin_order_in_input, run.num_threads);
+				row << stats.routed << ',' << stats.num_unrouted_connections << ',' << stats.num_used_routing_resources << ',' << stats.num_explored << ',' << stats.seconds << ',';
+			} catch (const std::exception& e) {
+				row << ",,,,," << csv_field(e.what());
+				num_failed_runs += 1;
+			}
+			row << '\n';
+
+			std::lock_guard<std::mutex> csv_lock(csv_mutex);
+			csv << row.str() << std::flush;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int ithread = 0; ithread < num_concurrent_runs; ++ithread) {
+		threads.emplace_back(do_runs);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	dout(DL::INFO) << "sweep done. " << num_failed_runs << " runs failed\n";
+
+	return num_failed_runs;
+}
+
+} // end namespace flows
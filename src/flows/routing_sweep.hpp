@@ -0,0 +1,46 @@
+#ifndef FLOWS__ROUTING_SWEEP_H
+#define FLOWS__ROUTING_SWEEP_H
+
+#include <device/device.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace flows {
+
+/**
+ * The parameters of a sweep. Every combination is one configuration.
+ */
+struct SweepGrid {
+	std::vector<std::string> data_files;
+	std::vector<std::string> device_type_names;
+	std::vector<int> track_widths; // if empty, use the track width in each data file
+	std::vector<int> thread_counts;
+	int repeats;
+};
+
+/**
+ * Read a grid from lines of the form `<key> <value>...`, where the keys are
+ * data-file, device-type, track-width, num-threads, and repeats. Keys may be
+ * given more than once, adding more values. Blank lines and lines starting
+ * with '#' are ignored.
+ */
+SweepGrid parse_sweep_grid(std::istream& is, int default_num_threads);
+
+/**
+ * Route each configuration in the grid (`repeats` times), running up to
+ * num_concurrent_runs at once on a fixed set of threads. Each data file is
+ * parsed once, and each device is built once and shared between the runs
+ * that use it. Runs going at once share the cores, so their times are only
+ * comparable with num_concurrent_runs = 1. Graphics mustn't be on, as they're
+ * only safe to push to from one thread.
+ *
+ * Writes a CSV header, then one row per run as it finishes, to `csv`.
+ * Returns the number of runs that failed with an error.
+ */
+int run_sweep(const SweepGrid& grid, int num_concurrent_runs, std::ostream& csv);
+
+} // end namespace flows
+
+#endif // FLOWS__ROUTING_SWEEP_H
@@ -5,17 +5,13 @@
 #include <util/lambda_compose.hpp>
 #include <util/logging.hpp>
 
-namespace {
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
 
-template<typename T>
-bool is_contained_in_a_path(device::RouteElementID reid, const T& paths) {
-	for (const auto& path : paths) {
-		if (std::find(begin(path), end(path), reid) != end(path)) {
-			return true;
-		}
-	}
-	return false;
-}
+namespace {
 
 template<typename X, typename Y>
 auto bounds_for_xy(X x, Y y) {
@@ -118,8 +114,204 @@ std::pair<graphics::t_point, graphics::t_point> calculateWireLocation(const devi
 	}
 }
 
+using WireLocation = std::pair<graphics::t_point, graphics::t_point>;
+
+auto normalized_bounds(const graphics::t_point& p1, const graphics::t_point& p2) {
+	return graphics::t_bound_box(
+		std::min(p1.x, p2.x), std::min(p1.y, p2.y),
+		std::max(p1.x, p2.x), std::max(p1.y, p2.y)
+	);
+}
+
+/**
+ * Both boxes must be normalized - ie. left <= right & bottom <= top
+ */
+bool overlaps(const graphics::t_bound_box& lhs, const graphics::t_bound_box& rhs) {
+	return lhs.left() <= rhs.right() && rhs.left() <= lhs.right()
+		&& lhs.bottom() <= rhs.top() && rhs.bottom() <= lhs.top();
+}
+
+auto visible_world_bounds() {
+	const auto visible = graphics::get_visible_world();
+	return normalized_bounds(visible.bottom_left(), visible.top_right());
+}
+
+/**
+ * Whether a grid square is big enough on screen for individual wires (and their labels)
+ * to be worth drawing. If not, channels are drawn as congestion bars instead.
+ */
+bool wires_are_legible() {
+	return graphics::LOD_screen_area_test(bounds_for_xy(0, 0), 40.0f*40.0f);
+}
+
+/**
+ * The device's blocks, and every RE reachable from their pins with where it is drawn, bucketed
+ * by the grid square it belongs to. It is built once per device, so a redraw only looks at the
+ * visible squares and never recomputes a wire's location. Drawing from this never touches the
+ * device, which might be gone before a recorded frame is drawn.
+ */
+class WireTileGrid {
+public:
+	struct PlacedWire {
+		device::RouteElementID id;
+		WireLocation location;
+		device::BlockSide channel; ///< OTHER for pins
+	};
+
+	template<typename Device>
+	explicit WireTileGrid(const Device& device)
+		: device_address(&device)
+		, device_info(device.info())
+		, device_blocks()
+		, min_x(0)
+		, min_y(0)
+		, width(0)
+		, height(0)
+		, tiles()
+	{
+		std::vector<device::RouteElementID> pins;
+		for (const auto& block : device.blocks()) {
+			device_blocks.push_back(block);
+			for (const auto& pin_re : device.fanout(block)) {
+				pins.push_back(pin_re);
+			}
+		}
+
+		std::vector<device::RouteElementID> all_res;
+		util::GraphAlgo<device::RouteElementID>().breadthFirstVisit(device, pins, [&](const auto& curr) {
+			all_res.push_back(curr);
+		});
+
+		if (all_res.empty()) {
+			return;
+		}
+
+		int max_x = min_x = all_res.front().getX().getValue();
+		int max_y = min_y = all_res.front().getY().getValue();
+		for (const auto& reid : all_res) {
+			min_x = std::min<int>(min_x, reid.getX().getValue());
+			max_x = std::max<int>(max_x, reid.getX().getValue());
+			min_y = std::min<int>(min_y, reid.getY().getValue());
+			max_y = std::max<int>(max_y, reid.getY().getValue());
+		}
+		width = max_x - min_x + 1;
+		height = max_y - min_y + 1;
+		tiles.resize((std::size_t)(width*height));
+
+		for (const auto& reid : all_res) {
+			const auto channel = reid.isPin() ? device::BlockSide::OTHER : channel_location(device.wire_direction(reid));
+			tiles[tileIndex(reid.getX().getValue(), reid.getY().getValue())].push_back({reid, calculateWireLocation(reid, device), channel});
+		}
+	}
+
+	WireTileGrid(const WireTileGrid&) = delete;
+	WireTileGrid& operator=(const WireTileGrid&) = delete;
+
+	template<typename Device>
+	bool isFor(const Device& device) const {
+		return device_address == &device
+			&& device_info.bounds.min_point() == device.info().bounds.min_point()
+			&& device_info.bounds.max_point() == device.info().bounds.max_point()
+			&& device_info.track_width == device.info().track_width;
+	}
+
+	const std::vector<device::BlockID>& blocks() const { return device_blocks; }
+
+	boost::optional<WireLocation> locationOf(const device::RouteElementID& reid) const {
+		const int x = reid.getX().getValue();
+		const int y = reid.getY().getValue();
+		if (x < min_x || x >= min_x + width || y < min_y || y >= min_y + height) {
+			return boost::none;
+		}
+		for (const auto& wire : tiles[tileIndex(x, y)]) {
+			if (wire.id == reid) {
+				return wire.location;
+			}
+		}
+		return boost::none;
+	}
+
+	/**
+	 * Calls visitor(x, y, wires) for each grid square that could have a wire inside world_bounds
+	 */
+	template<typename Visitor>
+	void forEachTileIn(const graphics::t_bound_box& world_bounds, Visitor&& visitor) const {
+		// wires can reach up to a square outside of the one they belong to
+		const int lo_x = std::max(min_x, (int)std::floor(world_bounds.left()) - 1);
+		const int hi_x = std::min(min_x + width - 1, (int)std::ceil(world_bounds.right()));
+		const int lo_y = std::max(min_y, (int)std::floor(world_bounds.bottom()) - 1);
+		const int hi_y = std::min(min_y + height - 1, (int)std::ceil(world_bounds.top()));
+		for (int y = lo_y; y <= hi_y; ++y) {
+			for (int x = lo_x; x <= hi_x; ++x) {
+				visitor(x, y, tiles[tileIndex(x, y)]);
+			}
+		}
+	}
+
+private:
+	std::size_t tileIndex(int x, int y) const {
+		return (std::size_t)((y - min_y)*width + (x - min_x));
+	}
+
+	const void* device_address;
+	device::DeviceInfo device_info;
+	std::vector<device::BlockID> device_blocks;
+	int min_x;
+	int min_y;
+	int width;
+	int height;
+	std::vector<std::vector<PlacedWire>> tiles;
+};
+
+/**
+ * Grids are built by the drawing thread, or, when recording, by the thread pushing states.
+ */
+template<typename Device>
+std::shared_ptr<const WireTileGrid> wire_tile_grid_for(const Device& device) {
+	static std::mutex cache_mutex;
+	static std::shared_ptr<const WireTileGrid> cached;
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (!cached || !cached->isFor(device)) {
+		cached = std::make_shared<const WireTileGrid>(device);
+	}
+	return cached;
+}
+
+std::shared_ptr<const WireTileGrid> wire_tile_grid_of(const graphics::FPGAGraphicsDataState& data) {
+	return boost::apply_visitor(util::compose_withbase<boost::static_visitor<std::shared_ptr<const WireTileGrid>>>(
+		[](std::nullptr_t) { return std::shared_ptr<const WireTileGrid>(); },
+		[](const auto* device) { return device ? wire_tile_grid_for(*device) : std::shared_ptr<const WireTileGrid>(); }
+	), data.getDevice());
+}
+
+/**
+ * Fills each visible channel with a colour from white (nothing used) to red (every track used)
+ */
+void drawCongestion(const WireTileGrid& grid, const graphics::t_bound_box& visible_world, const std::unordered_set<device::RouteElementID>& used) {
+	grid.forEachTileIn(visible_world, [&](int x, int y, const auto& wires) {
+		for (const auto side : {device::BlockSide::BOTTOM, device::BlockSide::LEFT}) {
+			int total = 0;
+			int in_use = 0;
+			for (const auto& wire : wires) {
+				if (wire.channel == side) {
+					total += 1;
+					in_use += (int)used.count(wire.id);
+				}
+			}
+			if (total == 0) {
+				continue;
+			}
+
+			const auto fade = (uint_fast8_t)(0xFF - (0xFF*in_use)/total);
+			graphics::setcolor(graphics::t_color(0xFF, fade, fade));
+			graphics::fillrect(channel_bounds_for_block_at(x, y, side));
+		}
+	});
+	graphics::setcolor(0,0,0);
+}
+
 template<typename Device>
-auto drawBlocks(Device&& device) {
+auto drawBlocks(Device&& device, const graphics::t_bound_box& visible_world, bool draw_labels) {
 	std::unordered_map<device::BlockID, graphics::t_bound_box> block_locations;
 	for (const auto& block : device.blocks()) {
 		const auto xy_loc = geom::make_point(
@@ -131,35 +323,56 @@ auto drawBlocks(Device&& device) {
 		const auto block_bounds = block_bounds_within(grid_square_bounds);
 		block_locations.emplace(block, block_bounds);
 
+		if (!overlaps(grid_square_bounds, visible_world)) {
+			continue;
+		}
+
 		graphics::drawrect(block_bounds);
-		graphics::settextrotation(0);
-		graphics::setfontsize(8);
-		graphics::drawtext_in(block_bounds, util::stringify_through_stream(geom::make_point(block.getX().getValue(), block.getY().getValue())));
+		if (draw_labels) {
+			graphics::settextrotation(0);
+			graphics::setfontsize(8);
+			graphics::drawtext_in(block_bounds, util::stringify_through_stream(geom::make_point(block.getX().getValue(), block.getY().getValue())));
+		}
 	}
 
 	return block_locations;
 }
 
-template<typename Device>
-void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
+void drawRouting(const WireTileGrid& wire_grid, const graphics::FPGAGraphicsDataState& data) {
+	const auto visible_world = visible_world_bounds();
+	const bool draw_wires = wires_are_legible();
 
 	graphics::setlinestyle(graphics::SOLID);
 	graphics::setcolor(0,0,0);
 
-	std::vector<device::RouteElementID> reIDs_to_draw;
 	std::unordered_set<device::RouteElementID> already_drawn;
 	std::unordered_map<device::RouteElementID, graphics::t_color> colour_overrides;
 
-	drawBlocks(device);
+	drawBlocks(wire_grid, visible_world, draw_wires);
 
-	for (const auto& block : device.blocks()) {
-		for (const auto& pin_re : device.fanout(block)) {
-			reIDs_to_draw.push_back(pin_re);
+	if (!draw_wires) {
+		std::unordered_set<device::RouteElementID> used;
+		for (const auto& root_id : data.getNetlist().roots()) {
+			data.getNetlist().for_all_descendants(root_id, 0, [&](const auto& id, int) {
+				used.insert(id);
+				return 0;
+			});
+		}
+		for (const auto& path : data.getPaths()) {
+			used.insert(begin(path), end(path));
 		}
+		for (const auto& id_and_colour : data.getExtraColours()) {
+			used.insert(id_and_colour.first);
+		}
+		drawCongestion(wire_grid, visible_world, used);
+		return;
 	}
 
-	const auto& drawWire = [&](const auto& curr, boost::optional<graphics::t_color> colour = boost::none) {
-		const auto wire_loc = calculateWireLocation(curr, device);
+	const auto& drawWireAt = [&](const auto& curr, const WireLocation& wire_loc, boost::optional<graphics::t_color> colour = boost::none) {
+		if (!overlaps(normalized_bounds(wire_loc.first, wire_loc.second), visible_world)) {
+			return;
+		}
+
 		const auto angle = geom::inclination(geom::make_point(wire_loc.first.x, wire_loc.first.y), geom::make_point(wire_loc.second.x, wire_loc.second.y));
 
 		if (colour) {
@@ -173,7 +386,7 @@ void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
 				if (extracolours_find_result != end(data.getExtraColours())) {
 					graphics::setcolor(extracolours_find_result->second);
 				} else {
-					return wire_loc;
+					return;
 				}
 			}
 		}
@@ -183,8 +396,16 @@ void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
 		graphics::drawtext_in(graphics::t_bound_box(wire_loc.first,wire_loc.second), util::stringify_through_stream(curr), 0.02f);
 
 		graphics::setcolor(0,0,0);
+	};
 
-		return wire_loc;
+	const auto& drawWire = [&](const auto& curr, boost::optional<graphics::t_color> colour = boost::none) {
+		const auto wire_loc = wire_grid.locationOf(curr);
+		if (!wire_loc) {
+			dout(DL::WARN) << "not sure where to draw " << curr << '\n';
+			return WireLocation();
+		}
+		drawWireAt(curr, *wire_loc, colour);
+		return *wire_loc;
 	};
 
 	const auto& drawConnection = [&](const auto& colour, const std::pair<device::RouteElementID, std::pair<graphics::t_point, graphics::t_point>>& wire_and_loc1, const std::pair<device::RouteElementID, std::pair<graphics::t_point, graphics::t_point>>& wire_and_loc2) {
@@ -200,6 +421,10 @@ void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
 				< geom::l1_distance(geom::make_point(rhs.first.x, rhs.first.y), geom::make_point(rhs.second.x, rhs.second.y));
 		});
 
+		if (!overlaps(normalized_bounds(point_pair.first, point_pair.second), visible_world)) {
+			return;
+		}
+
 		graphics::setcolor(colour);
 		graphics::drawline(point_pair.first, point_pair.second);
 
@@ -237,7 +462,6 @@ void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
 				drawConnection(net_colour, {state.parent, state.parent_loc}, {id, wire_loc});
 			}
 			already_drawn.insert(id);
-			reIDs_to_draw.push_back(id); // make sure that other fanouts are drawn?
 			return {id, wire_loc};
 		});
 		net_number++;
@@ -253,29 +477,19 @@ void drawDevice(Device&& device, const graphics::FPGAGraphicsDataState& data) {
 			}
 			prev_loc = std::make_pair(id, wire_loc);
 			already_drawn.insert(id);
-			reIDs_to_draw.push_back(id); // make sure that other fanouts are drawn?
 		}
 	}
 
 
-	util::GraphAlgo<device::RouteElementID>().breadthFirstVisit(device, reIDs_to_draw, [&](const auto& curr) {
-		if (already_drawn.find(curr) == end(already_drawn)) {
-			drawWire(curr);
+	wire_grid.forEachTileIn(visible_world, [&](int, int, const auto& wires) {
+		for (const auto& wire : wires) {
+			if (already_drawn.find(wire.id) == end(already_drawn)) {
+				drawWireAt(wire.id, wire.location);
+			}
 		}
 	});
-
-}
-
-template<typename Device>
-void drawDevice(Device* device, const graphics::FPGAGraphicsDataState& data) {
-	if (device) {
-		drawDevice(*device, data);
-	}
 }
 
-template<> void drawDevice(const std::nullptr_t&, const graphics::FPGAGraphicsDataState&) { }
-// template<> void drawDevice(std::nullptr_t&, const graphics::FPGAGraphicsDataState&) { }
-
 void drawPlacementData(const graphics::detail::FPGAGraphicsDataState_Placement& data) {
 
 	graphics::setcolor(0,0,0);
@@ -285,7 +499,7 @@ void drawPlacementData(const graphics::detail::FPGAGraphicsDataState_Placement&
 		10,
 		1,
 		2,
-	}));
+	}), visible_world_bounds(), wires_are_legible());
 
 	auto location_of = [&](const auto& atom) -> graphics::t_point {
 		const auto fixed_block_lookup = data.fixedBlockLocations().find(atom);
@@ -363,29 +577,42 @@ void drawPlacementData(const graphics::detail::FPGAGraphicsDataState_Placement&
 	}
 }
 
+/**
+ * Draws the state, with its device's already built grid, so doesn't touch the device itself.
+ */
+void drawState(const graphics::FPGAGraphicsDataState& data, const WireTileGrid* wire_grid) {
+	if (wire_grid) {
+		drawRouting(*wire_grid, data);
+	}
+
+	if (data.getPDev()) {
+		drawPlacementData(data);
+	}
+}
+
 } // end anon namespace
 
 namespace graphics {
 
-void FPGAGraphicsData::do_graphics_refresh(bool reset_view, const geom::BoundBox<float>& fpga_bb) {
+void FPGAGraphicsData::do_graphics_refresh(bool reset_view, const geom::BoundBox<float>& fpga_bb, std::shared_ptr<const FPGAGraphicsDataState> state) {
+	const float margin = 3.0f;
+	const auto visible_world = geom::BoundBox<float>(fpga_bb.minx()-margin, fpga_bb.miny()-margin, fpga_bb.maxx()+margin, fpga_bb.maxy()+margin);
+	if (recorder) {
+		auto wire_grid = wire_tile_grid_of(*state);
+		recorder(visible_world, [state, wire_grid]() {
+			drawState(*state, wire_grid.get());
+		});
+		return;
+	}
 	if (reset_view) {
-		const float margin = 3.0f;
-		graphics::set_visible_world(fpga_bb.minx()-margin, fpga_bb.miny()-margin, fpga_bb.maxx()+margin, fpga_bb.maxy()+margin);
+		graphics::set_visible_world(visible_world.minx(), visible_world.miny(), visible_world.maxx(), visible_world.maxy());
 	}
 	graphics::refresh_graphics();
 }
 
 void FPGAGraphicsData::drawAll() {
-	const auto& data_and_lock_copy = dataAndLock();
-	const auto& data = data_and_lock_copy.first;
-
-	boost::apply_visitor(util::compose_withbase<boost::static_visitor<void>>([&](auto&& device) {
-		drawDevice(device, data);
-	}), data.getDevice());
-
-	if (data.getPDev()) {
-		drawPlacementData(data);
-	}
+	const auto state = currentState();
+	drawState(*state, wire_tile_grid_of(*state).get());
 }
 
 } // end namespace graphics
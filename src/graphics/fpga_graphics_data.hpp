@@ -5,9 +5,12 @@
 #include <device/device.hpp>
 #include <device/placement_device.hpp>
 #include <graphics/graphics_types.hpp>
+#include <graphics/graphics_wrapper.hpp>
 #include <util/netlist.hpp>
 
-#include <mutex>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace graphics {
@@ -16,27 +19,59 @@ class FPGAGraphicsDataStateScope;
 
 namespace detail {
 
+	template<typename T>
+	using Snapshot = std::shared_ptr<const T>;
+
+	/**
+	 * Moves (or copies) t into a new immutable snapshot, which can then be shared by any number of states.
+	 */
+	template<typename T>
+	Snapshot<std::decay_t<T>> make_snapshot(T&& t) {
+		return std::make_shared<std::decay_t<T>>(std::forward<T>(t));
+	}
+
+	/**
+	 * A single shared snapshot of a default constructed T, so that empty states don't allocate.
+	 */
+	template<typename T>
+	const Snapshot<T>& empty_snapshot() {
+		static const Snapshot<T> empty = std::make_shared<T>();
+		return empty;
+	}
+
+	template<typename T>
+	Snapshot<T> snapshot_or_empty(Snapshot<T> snapshot) {
+		return snapshot ? std::move(snapshot) : empty_snapshot<T>();
+	}
+
+	/**
+	 * Everything is held in immutable snapshots, so copying a state - or handing it
+	 * to the drawing thread - never copies what it refers to.
+	 */
 	class FPGAGraphicsDataState_Routing {
-		using Netlist = util::Netlist<device::RouteElementID>;
 	public:
+		using Netlist = util::Netlist<device::RouteElementID>;
+		using Paths = std::vector<std::vector<device::RouteElementID>>;
+		using ColourMap = std::unordered_map<device::RouteElementID, graphics::t_color>;
+
 		FPGAGraphicsDataState_Routing()
 			: device(nullptr)
-			, paths()
-			, netlist()
-			, extra_colours_to_draw()
+			, paths(empty_snapshot<Paths>())
+			, netlist(empty_snapshot<Netlist>())
+			, extra_colours_to_draw(empty_snapshot<ColourMap>())
 		{ }
 
 		template<typename Device>
 		FPGAGraphicsDataState_Routing(
 			Device const* device,
-			const std::vector<std::vector<device::RouteElementID>>& paths,
-			const Netlist& netlist,
-			std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw
+			Snapshot<Paths> paths,
+			Snapshot<Netlist> netlist,
+			Snapshot<ColourMap> extra_colours_to_draw
 		)
 			: device(device)
-			, paths(paths)
-			, netlist(netlist)
-			, extra_colours_to_draw(std::move(extra_colours_to_draw))
+			, paths(snapshot_or_empty(std::move(paths)))
+			, netlist(snapshot_or_empty(std::move(netlist)))
+			, extra_colours_to_draw(snapshot_or_empty(std::move(extra_colours_to_draw)))
 		{ }
 
 		FPGAGraphicsDataState_Routing(const FPGAGraphicsDataState_Routing&) = default;
@@ -45,27 +80,24 @@ namespace detail {
 		FPGAGraphicsDataState_Routing& operator=(const FPGAGraphicsDataState_Routing&) = default;
 		FPGAGraphicsDataState_Routing& operator=(FPGAGraphicsDataState_Routing&&) = default;
 
-		      auto& getPaths()       { return paths; }
-		const auto& getPaths() const { return paths; }
-
-		      auto& getNetlist()       { return netlist; }
-		const auto& getNetlist() const { return netlist; }
-
-		      auto& getDevice()       { return device; }
+		const Paths& getPaths() const { return *paths; }
+		const Netlist& getNetlist() const { return *netlist; }
 		const auto& getDevice() const { return device; }
-
-		      auto& getExtraColours()       { return extra_colours_to_draw; }
-		const auto& getExtraColours() const { return extra_colours_to_draw; }
+		const ColourMap& getExtraColours() const { return *extra_colours_to_draw; }
 
 	private:
 		template <typename... Ts> using variant_with_nullptr = boost::variant<std::nullptr_t, Ts...>;
 		util::substitute_into<variant_with_nullptr, util::add_pointer_to_const_t, ALL_DEVICES_COMMA_SEP> device;
-		std::vector<std::vector<device::RouteElementID>> paths;
-		Netlist netlist;
-		std::unordered_map<device::RouteElementID, graphics::t_color> extra_colours_to_draw;
+		Snapshot<Paths> paths;
+		Snapshot<Netlist> netlist;
+		Snapshot<ColourMap> extra_colours_to_draw;
 	};
 
 	struct FPGAGraphicsDataState_Placement {
+		using NetMembers = std::vector<std::vector<device::AtomID>>;
+		using FixedLocations = std::unordered_map<device::AtomID, device::BlockID>;
+		using PointLocations = std::unordered_map<device::AtomID, geom::Point<double>>;
+
 		FPGAGraphicsDataState_Placement()
 			: FPGAGraphicsDataState_Placement(
 				{},
@@ -78,90 +110,76 @@ namespace detail {
 
 		FPGAGraphicsDataState_Placement(
 			const boost::optional<device::PlacementDevice> device,
-			const std::vector<std::vector<device::AtomID>>& net_members,
-			const std::unordered_map<device::AtomID, device::BlockID>& fixed_block_locations,
-			const std::unordered_map<device::AtomID, geom::Point<double>>& nonmoveable_block_locations,
-			const std::unordered_map<device::AtomID, geom::Point<double>>& moveable_block_locations
+			Snapshot<NetMembers> net_members,
+			Snapshot<FixedLocations> fixed_block_locations,
+			Snapshot<PointLocations> nonmoveable_block_locations,
+			Snapshot<PointLocations> moveable_block_locations
 		)
 			: pdev(device)
-			, net_members(net_members)
-			, fixed_block_locations(fixed_block_locations)
-			, nonmoveable_block_locations(nonmoveable_block_locations)
-			, moveable_block_locations(moveable_block_locations)
+			, net_members(snapshot_or_empty(std::move(net_members)))
+			, fixed_block_locations(snapshot_or_empty(std::move(fixed_block_locations)))
+			, nonmoveable_block_locations(snapshot_or_empty(std::move(nonmoveable_block_locations)))
+			, moveable_block_locations(snapshot_or_empty(std::move(moveable_block_locations)))
 		{ }
 
 		const auto& getPDev() const { return pdev; }
-		      auto& getPDev()       { return pdev; }
-
-		const auto& netMembers() const { return net_members; }
-		      auto& netMembers()       { return net_members; }
-
-		const auto& fixedBlockLocations() const { return fixed_block_locations; }
-		      auto& fixedBlockLocations()       { return fixed_block_locations; }
-
-		const auto& nonmoveableBlockLocations() const { return nonmoveable_block_locations; }
-		      auto& nonmoveableBlockLocations()       { return nonmoveable_block_locations; }
-
-		const auto& moveableBlockLocations() const { return moveable_block_locations; }
-		      auto& moveableBlockLocations()       { return moveable_block_locations; }
+		const NetMembers& netMembers() const { return *net_members; }
+		const FixedLocations& fixedBlockLocations() const { return *fixed_block_locations; }
+		const PointLocations& nonmoveableBlockLocations() const { return *nonmoveable_block_locations; }
+		const PointLocations& moveableBlockLocations() const { return *moveable_block_locations; }
 
 	private:
 		boost::optional<device::PlacementDevice> pdev;
-		std::vector<std::vector<device::AtomID>> net_members;
-		std::unordered_map<device::AtomID, device::BlockID> fixed_block_locations;
-		std::unordered_map<device::AtomID, geom::Point<double>> nonmoveable_block_locations;
-		std::unordered_map<device::AtomID, geom::Point<double>> moveable_block_locations;
+		Snapshot<NetMembers> net_members;
+		Snapshot<FixedLocations> fixed_block_locations;
+		Snapshot<PointLocations> nonmoveable_block_locations;
+		Snapshot<PointLocations> moveable_block_locations;
 	};
 
 }
 
 struct FPGAGraphicsDataState : public detail::FPGAGraphicsDataState_Routing, public detail::FPGAGraphicsDataState_Placement {
-	using Netlist = util::Netlist<device::RouteElementID>;
-
 	struct routing_state_tag {};
 	struct placement_state_tag {};
 
 	FPGAGraphicsDataState()
 		: FPGAGraphicsDataState_Routing()
 		, FPGAGraphicsDataState_Placement()
-		, enabled(true)
 	{ }
 
 	template<typename Device>
 	FPGAGraphicsDataState(
 		routing_state_tag,
 		Device const* device,
-		const std::vector<std::vector<device::RouteElementID>>& paths,
-		const Netlist& netlist,
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw
+		detail::Snapshot<Paths> paths,
+		detail::Snapshot<Netlist> netlist,
+		detail::Snapshot<ColourMap> extra_colours_to_draw
 	)
 		: FPGAGraphicsDataState_Routing(
 			device,
-			paths,
-			netlist,
+			std::move(paths),
+			std::move(netlist),
 			std::move(extra_colours_to_draw)
 		)
 		, FPGAGraphicsDataState_Placement()
-		, enabled(true)
 	{ }
 
 	FPGAGraphicsDataState(
 		placement_state_tag,
 		const boost::optional<device::PlacementDevice> device,
-		const std::vector<std::vector<device::AtomID>>& net_members,
-		const std::unordered_map<device::AtomID, device::BlockID>& fixed_block_locations,
-		const std::unordered_map<device::AtomID, geom::Point<double>>& nonmoveable_block_locations,
-		const std::unordered_map<device::AtomID, geom::Point<double>>& moveable_block_locations
+		detail::Snapshot<NetMembers> net_members,
+		detail::Snapshot<FixedLocations> fixed_block_locations,
+		detail::Snapshot<PointLocations> nonmoveable_block_locations,
+		detail::Snapshot<PointLocations> moveable_block_locations
 	)
 		: FPGAGraphicsDataState_Routing()
 		, FPGAGraphicsDataState_Placement(
 			device,
-			net_members,
-			fixed_block_locations,
-			nonmoveable_block_locations,
-			moveable_block_locations
+			std::move(net_members),
+			std::move(fixed_block_locations),
+			std::move(nonmoveable_block_locations),
+			std::move(moveable_block_locations)
 		)
-		, enabled(true)
 	{ }
 
 	FPGAGraphicsDataState(const FPGAGraphicsDataState&) = default;
@@ -169,42 +187,41 @@ struct FPGAGraphicsDataState : public detail::FPGAGraphicsDataState_Routing, pub
 
 	FPGAGraphicsDataState& operator=(const FPGAGraphicsDataState&) = default;
 	FPGAGraphicsDataState& operator=(FPGAGraphicsDataState&&) = default;
-
-	bool isEnabled() { return enabled; }
-
-private:
-	friend class FPGAGraphicsDataStateScope;
-
-	bool enabled;
 };
 
+class FPGAGraphicsData;
+
+/**
+ * Removes its state from the FPGAGraphicsData it was pushed to when it goes out of scope.
+ */
 class FPGAGraphicsDataStateScope {
 public:
-	FPGAGraphicsDataStateScope(FPGAGraphicsDataState* src)
-		: src(src)
+	FPGAGraphicsDataStateScope(FPGAGraphicsData* owner, const FPGAGraphicsDataState* src)
+		: owner(owner)
+		, src(src)
 	{ }
 
 	FPGAGraphicsDataStateScope(const FPGAGraphicsDataStateScope&) = delete;
 	FPGAGraphicsDataStateScope& operator=(const FPGAGraphicsDataStateScope&) = delete;
 
 	FPGAGraphicsDataStateScope(FPGAGraphicsDataStateScope&& other)
-		: src(nullptr)
+		: owner(nullptr)
+		, src(nullptr)
 	{
+		std::swap(owner, other.owner);
 		std::swap(src, other.src);
 	}
 
 	FPGAGraphicsDataStateScope& operator=(FPGAGraphicsDataStateScope&& rhs) {
+		std::swap(owner, rhs.owner);
 		std::swap(src, rhs.src);
 		return *this;
 	}
 
-	~FPGAGraphicsDataStateScope() {
-		if (src) {
-			src->enabled = false;
-		}
-	}
+	~FPGAGraphicsDataStateScope();
 private:
-	FPGAGraphicsDataState* src;
+	FPGAGraphicsData* owner;
+	const FPGAGraphicsDataState* src;
 };
 
 class Graphics;
@@ -215,11 +232,19 @@ namespace detail{
 
 class FPGAGraphicsData {
 public:
+	using Paths = FPGAGraphicsDataState::Paths;
+	using Netlist = FPGAGraphicsDataState::Netlist;
+	using ColourMap = FPGAGraphicsDataState::ColourMap;
+	template<typename T> using Snapshot = detail::Snapshot<T>;
+
 	FPGAGraphicsData()
 		: state_stack()
-		, state_owner_count()
+		, published_state()
+		, keep_states(false)
+		, recorder()
 	{
-		state_stack.emplace_back(std::make_unique<FPGAGraphicsDataState>());
+		state_stack.push_back({std::make_shared<FPGAGraphicsDataState>(), true});
+		std::atomic_store(&published_state, state_stack.back().state);
 	}
 
 	FPGAGraphicsData(const FPGAGraphicsData&) = delete;
@@ -228,15 +253,47 @@ public:
 	FPGAGraphicsData& operator=(const FPGAGraphicsData&) = delete;
 	FPGAGraphicsData& operator=(FPGAGraphicsData&&) = default;
 
+	/**
+	 * States are only kept if there is something that might draw them. Otherwise
+	 * pushing one does nothing, which also makes it safe to push from many threads.
+	 */
+	void setKeepStates(bool keep) { keep_states = keep; }
+
+	/**
+	 * Called for every pushed state with what should be visible, and something that draws it
+	 * without needing the state's device to still exist, instead of refreshing the window.
+	 * For recording - see Graphics::enableRecording.
+	 */
+	using Recorder = std::function<void(const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame)>;
+	void setRecorder(Recorder new_recorder) { recorder = std::move(new_recorder); }
+
+	/**
+	 * The O(1) push: shares the given snapshots (null means empty) instead of copying anything.
+	 * The overloads below copy their arguments into snapshots first (colour maps are moved), and only if states are being kept.
+	 */
+	template<typename Device>
+	FPGAGraphicsDataStateScope pushRoutingState(
+		Device const* device,
+		Snapshot<Paths> paths,
+		Snapshot<Netlist> netlist,
+		Snapshot<ColourMap> extra_colours_to_draw,
+		bool reset_view = false
+	) {
+		return pushRoutingState_base(device, std::move(paths), std::move(netlist), std::move(extra_colours_to_draw), reset_view);
+	}
+
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		const std::vector<std::vector<device::RouteElementID>>& paths,
-		const util::Netlist<device::RouteElementID>& netlist,
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw,
+		const Paths& paths,
+		const Netlist& netlist,
+		ColourMap&& extra_colours_to_draw,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, paths, netlist, std::move(extra_colours_to_draw), reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, detail::make_snapshot(paths), detail::make_snapshot(netlist), detail::make_snapshot(std::move(extra_colours_to_draw)), reset_view);
 	}
 
 	template<typename Device>
@@ -244,127 +301,201 @@ public:
 		Device const* device,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, {}, {}, {}, reset_view);
+		return pushRoutingState_base(device, nullptr, nullptr, nullptr, reset_view);
 	}
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		const std::vector<std::vector<device::RouteElementID>>& paths,
+		const Paths& paths,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, paths, {}, {}, reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, detail::make_snapshot(paths), nullptr, nullptr, reset_view);
 	}
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		const std::vector<std::vector<device::RouteElementID>>& paths,
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw,
+		const Paths& paths,
+		ColourMap&& extra_colours_to_draw,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, paths, {}, extra_colours_to_draw, reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, detail::make_snapshot(paths), nullptr, detail::make_snapshot(std::move(extra_colours_to_draw)), reset_view);
 	}
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		const util::Netlist<device::RouteElementID>& netlist,
+		const Netlist& netlist,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, {}, netlist, {}, reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, nullptr, detail::make_snapshot(netlist), nullptr, reset_view);
 	}
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		const util::Netlist<device::RouteElementID>& netlist,
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw,
+		const Netlist& netlist,
+		ColourMap&& extra_colours_to_draw,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, {}, netlist, extra_colours_to_draw, reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, nullptr, detail::make_snapshot(netlist), detail::make_snapshot(std::move(extra_colours_to_draw)), reset_view);
 	}
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState(
 		Device const* device,
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw,
+		ColourMap&& extra_colours_to_draw,
+		bool reset_view = false
+	) {
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushRoutingState_base(device, nullptr, nullptr, detail::make_snapshot(std::move(extra_colours_to_draw)), reset_view);
+	}
+
+	FPGAGraphicsDataStateScope pushPlacingState(
+		const boost::optional<device::PlacementDevice> device,
+		Snapshot<FPGAGraphicsDataState::NetMembers> net_members,
+		Snapshot<FPGAGraphicsDataState::FixedLocations> fixed_block_locations,
+		Snapshot<FPGAGraphicsDataState::PointLocations> nonmoveable_block_locations,
+		Snapshot<FPGAGraphicsDataState::PointLocations> moveable_block_locations,
 		bool reset_view = false
 	) {
-		return pushRoutingState_base(device, {}, {}, std::move(extra_colours_to_draw), reset_view);
+		return pushPlacingState_base(device, std::move(net_members), std::move(fixed_block_locations), std::move(nonmoveable_block_locations), std::move(moveable_block_locations), reset_view);
 	}
 
 	FPGAGraphicsDataStateScope pushPlacingState(
 		const boost::optional<device::PlacementDevice> device,
-		const std::vector<std::vector<device::AtomID>>& net_members,
-		const std::unordered_map<device::AtomID, device::BlockID>& fixed_block_locations,
-		const std::unordered_map<device::AtomID, geom::Point<double>>& nonmoveable_block_locations,
-		const std::unordered_map<device::AtomID, geom::Point<double>>& moveable_block_locations,
+		const FPGAGraphicsDataState::NetMembers& net_members,
+		const FPGAGraphicsDataState::FixedLocations& fixed_block_locations,
+		const FPGAGraphicsDataState::PointLocations& nonmoveable_block_locations,
+		const FPGAGraphicsDataState::PointLocations& moveable_block_locations,
 		bool reset_view = false
 	) {
-		return pushPlacingState_base(device, net_members, fixed_block_locations, nonmoveable_block_locations, moveable_block_locations, reset_view);
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		return pushPlacingState_base(
+			device,
+			detail::make_snapshot(net_members),
+			detail::make_snapshot(fixed_block_locations),
+			detail::make_snapshot(nonmoveable_block_locations),
+			detail::make_snapshot(moveable_block_locations),
+			reset_view
+		);
 	}
 
 private:
 	friend class FPGAGraphics;
+	friend class FPGAGraphicsDataStateScope;
 	template<typename> friend class detail::pushState_instantiator;
 
 	template<typename Device>
 	FPGAGraphicsDataStateScope pushRoutingState_base(
-		Device const* device = nullptr,
-		const std::vector<std::vector<device::RouteElementID>>& paths = {},
-		const util::Netlist<device::RouteElementID>& netlist = {},
-		std::unordered_map<device::RouteElementID, graphics::t_color>&& extra_colours_to_draw = {},
-		bool reset_view = false
+		Device const* device,
+		Snapshot<Paths> paths,
+		Snapshot<Netlist> netlist,
+		Snapshot<ColourMap> extra_colours_to_draw,
+		bool reset_view
 	) {
-		state_stack.push_back(std::make_unique<FPGAGraphicsDataState>(FPGAGraphicsDataState::routing_state_tag{}, device, paths, netlist, std::move(extra_colours_to_draw)));
-		do_graphics_refresh(reset_view, device->info().bounds);
-		return FPGAGraphicsDataStateScope(state_stack.back().get());
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		const auto state = std::make_shared<const FPGAGraphicsDataState>(FPGAGraphicsDataState::routing_state_tag{}, device, std::move(paths), std::move(netlist), std::move(extra_colours_to_draw));
+		auto scope = pushState(state);
+		do_graphics_refresh(reset_view, device->info().bounds, state);
+		return scope;
 	}
 
 	FPGAGraphicsDataStateScope pushPlacingState_base(
-		const boost::optional<device::PlacementDevice> device = {},
-		const std::vector<std::vector<device::AtomID>>& net_members = {},
-		const std::unordered_map<device::AtomID, device::BlockID>& fixed_block_locations = {},
-		const std::unordered_map<device::AtomID, geom::Point<double>>& nonmoveable_block_locations = {},
-		const std::unordered_map<device::AtomID, geom::Point<double>>& moveable_block_locations = {},
-		bool reset_view = false
+		const boost::optional<device::PlacementDevice> device,
+		Snapshot<FPGAGraphicsDataState::NetMembers> net_members,
+		Snapshot<FPGAGraphicsDataState::FixedLocations> fixed_block_locations,
+		Snapshot<FPGAGraphicsDataState::PointLocations> nonmoveable_block_locations,
+		Snapshot<FPGAGraphicsDataState::PointLocations> moveable_block_locations,
+		bool reset_view
 	) {
-		state_stack.push_back(std::make_unique<FPGAGraphicsDataState>(
+		if (!compiled_in || !keep_states) {
+			return FPGAGraphicsDataStateScope(nullptr, nullptr);
+		}
+		const auto state = std::make_shared<const FPGAGraphicsDataState>(
 			FPGAGraphicsDataState::placement_state_tag{},
 			device,
-			net_members,
-			fixed_block_locations,
-			nonmoveable_block_locations,
-			moveable_block_locations
-		));
-		do_graphics_refresh(reset_view, geom::BoundBox<double>(0,0,1,1));
-		return FPGAGraphicsDataStateScope(state_stack.back().get());
+			std::move(net_members),
+			std::move(fixed_block_locations),
+			std::move(nonmoveable_block_locations),
+			std::move(moveable_block_locations)
+		);
+		auto scope = pushState(state);
+		do_graphics_refresh(reset_view, device ? geom::BoundBox<float>(device->info().bounds()) : geom::BoundBox<float>(0,0,1,1), state);
+		return scope;
 	}
 
-	void do_graphics_refresh(bool reset_view, const geom::BoundBox<float>& fpga_bb);
+	void do_graphics_refresh(bool reset_view, const geom::BoundBox<float>& fpga_bb, std::shared_ptr<const FPGAGraphicsDataState> state);
 
 	void drawAll();
 
-	struct StateLock {
-		int owner_count = 0;
-		void lock() { owner_count += 1; }
-		void unlock() { owner_count -= 1; }
+	/**
+	 * The stack is only touched by the thread pushing states. Its top is published
+	 * for the drawing thread, which just takes another reference to it.
+	 */
+	struct StackEntry {
+		std::shared_ptr<const FPGAGraphicsDataState> state;
+		bool enabled;
 	};
 
-	std::pair<FPGAGraphicsDataState&, std::unique_lock<StateLock>> dataAndLock() {
-		if (state_owner_count.owner_count == 0) {
-			while (state_stack.size() > 1 && !state_stack.back()->isEnabled()) {
-				state_stack.pop_back();
+	FPGAGraphicsDataStateScope pushState(std::shared_ptr<const FPGAGraphicsDataState> state) {
+		const auto* raw_state = state.get();
+		state_stack.push_back({std::move(state), true});
+		std::atomic_store(&published_state, state_stack.back().state);
+		return FPGAGraphicsDataStateScope(this, raw_state);
+	}
+
+	/**
+	 * Scopes may end out of order, so a state is only removed once everything above it is also gone.
+	 */
+	void popState(const FPGAGraphicsDataState* state) {
+		for (auto it = state_stack.rbegin(); it != state_stack.rend(); ++it) {
+			if (it->state.get() == state) {
+				it->enabled = false;
+				break;
 			}
 		}
-		return {*state_stack.back(), std::unique_lock<StateLock>(state_owner_count)};
+		while (state_stack.size() > 1 && !state_stack.back().enabled) {
+			state_stack.pop_back();
+		}
+		std::atomic_store(&published_state, state_stack.back().state);
+	}
+
+	std::shared_ptr<const FPGAGraphicsDataState> currentState() const {
+		return std::atomic_load(&published_state);
 	}
 
-	std::vector<std::unique_ptr<FPGAGraphicsDataState>> state_stack;
-	StateLock state_owner_count;
+	std::vector<StackEntry> state_stack;
+	std::shared_ptr<const FPGAGraphicsDataState> published_state;
+	bool keep_states;
+	Recorder recorder;
 };
 
+inline FPGAGraphicsDataStateScope::~FPGAGraphicsDataStateScope() {
+	if (owner) {
+		owner->popState(src);
+	}
+}
+
 } // end namespace graphics
 
 #endif // GRAPHICS__FPGA_GRAPHICS_DATA_H
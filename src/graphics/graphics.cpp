@@ -2237,6 +2237,10 @@ void drawtext(const t_point& text_center, const std::string& text, float boundx,
  * system (world or screen).
  */
 void drawtext(float xc, float yc, const std::string& str_text, float boundx, float boundy) {
+    // Text is measured with the display's fonts, so without a window it's left out.
+    if (!gl_state.initialized)
+        return;
+
     // Need a C-string to call the low-level (X11 or win32) apis.
     const char* text = str_text.c_str();  
     int text_byte_length = strlen(text);
@@ -3150,6 +3154,12 @@ void close_postscript(void) {
     update_transform(); /* Ensure screen world reflects any changes      *
 	* made while printing.                          */
 
+    /* Without a window (see draw_to_postscript_file) there's no graphics
+     * context to go back to.
+     */
+    if (!gl_state.initialized)
+        return;
+
     /* Need to make sure that we really set up the graphics context.  
      * The current font set indicates the last font used in a postscript call, 
      * etc., *NOT* the font set in the X11 or Win32 graphics context.  Force the
@@ -3163,6 +3173,24 @@ void close_postscript(void) {
     force_settextattrs(gl_state.currentfontsize, gl_state.currentfontrotation);
 }
 
+/* Draws one PostScript file of 'world', without needing init_graphics (and so *
+ * a display) to have been called. Returns 0 if the file couldn't be opened.  */
+int draw_to_postscript_file(const char *fname, const t_bound_box& world, std::function<void()> drawscreen) {
+    if (!gl_state.initialized) {
+        /* No window to take the size from, so pretend there's a typical one.  *
+         * Only its aspect ratio matters, for the level-of-detail tests.        */
+        trans_coord.top_width = 1024 + MWIDTH;
+        trans_coord.top_height = 768 + T_AREA_HEIGHT;
+    }
+
+    set_visible_world(world);
+    if (!init_postscript(fname))
+        return (0);
+    drawscreen();
+    close_postscript();
+    return (1);
+}
+
 /* Sets up the default menu buttons on the right hand side of the window. */
 static void
 build_default_menu(void) {
@@ -5354,6 +5382,10 @@ int init_postscript(const char* /*fname*/) {
 
 void close_postscript(void) { }
 
+int draw_to_postscript_file(const char* /*fname*/, const t_bound_box& /*world*/, std::function<void()> /*drawscreen*/) {
+    return (0);
+}
+
 void get_report_structure(t_report*) { }
 
 void set_mouse_move_input(bool) { }
@@ -463,6 +463,13 @@ int init_postscript(const char *fname); /* Returns 1 if successful */
 /* Closes file and directs output to screen again.       */
 void close_postscript(void);
 
+/* Draws one PostScript file: sets 'world' visible, then calls drawscreen with
+ * output going to fname. Unlike the above, this works without init_graphics
+ * having been called, so without a display -- though text is then left out, as
+ * there are no fonts to measure it with. Returns 1 if successful.
+ */
+int draw_to_postscript_file(const char *fname, const t_bound_box& world, std::function<void()> drawscreen);
+
 /******************** DEBUGGING FUNCTIONS **********************************/
 
 /* Data structure below is for debugging the easygl API itself; you normally
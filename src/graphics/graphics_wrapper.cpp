@@ -3,12 +3,19 @@
 #include <graphics/graphics.hpp>
 #include <util/thread_utils.hpp>
 
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
 #include <thread>
 
 namespace graphics {
 
 Graphics::Graphics()
 	: enabled(false)
+	, recording_file_prefix()
 	, impl(nullptr)
 { }
 
@@ -16,6 +23,11 @@ Graphics::~Graphics() { }
 
 class Graphics::Impl {
 private:
+	struct Frame {
+		geom::BoundBox<float> visible_world;
+		std::function<void()> draw;
+	};
+
 	bool initialized;
 	bool close_requested;
 	std::thread gui_thread;
@@ -23,6 +35,15 @@ private:
 	util::SafeWaitForNotify wait_for_proceed;
 
 	Graphics* graphics_interface;
+
+	// for recording. Bounded, so a producer that's faster than the drawing waits
+	// instead of piling up snapshots.
+	static const std::size_t max_queued_frames = 64;
+	bool recording;
+	std::deque<Frame> frames;
+	std::mutex frames_mutex;
+	std::condition_variable frames_changed;
+	std::condition_variable frames_taken;
 public:
 	Impl(Graphics* interface)
 		: initialized(false)
@@ -30,6 +51,11 @@ public:
 		, gui_thread()
 		, wait_for_proceed()
 		, graphics_interface(interface)
+		, recording(interface->isRecording())
+		, frames()
+		, frames_mutex()
+		, frames_changed()
+		, frames_taken()
 	{
 		startThreadsAndOpenWindow();
 	}
@@ -44,6 +70,13 @@ public:
 		initialized = true;
 		// XInitThreads();
 
+		if (recording) {
+			gui_thread = std::thread([this]() noexcept {
+				recordFrames(graphics_interface->recordingFilePrefix());
+			});
+			return;
+		}
+
 		gui_thread = std::thread([&]() noexcept {
 			// std::string title;
 			// for (int i = 0; i < argc; ++i) {
@@ -81,17 +114,68 @@ public:
 		});
 	}
 
+	/**
+	 * Draws each frame straight to its own PostScript file, without a window or display.
+	 */
+	void recordFrames(const std::string& file_prefix) {
+		int frame_number = 0;
+		while (true) {
+			std::deque<Frame> to_draw;
+			{
+				std::unique_lock<std::mutex> lock(frames_mutex);
+				frames_changed.wait(lock, [&]() { return close_requested || !frames.empty(); });
+				if (frames.empty()) {
+					break;
+				}
+				std::swap(to_draw, frames);
+			}
+			frames_taken.notify_all();
+
+			for (const auto& frame : to_draw) {
+				std::ostringstream file_name;
+				file_name << file_prefix << std::setw(6) << std::setfill('0') << frame_number << ".ps";
+				frame_number += 1;
+
+				const auto& vw = frame.visible_world;
+				graphics::draw_to_postscript_file(file_name.str().c_str(), graphics::t_bound_box(vw.minx(), vw.miny(), vw.maxx(), vw.maxy()), frame.draw);
+			}
+		}
+	}
+
+	void recordFrame(const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame) {
+		if (!recording) {
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(frames_mutex);
+			frames_taken.wait(lock, [&]() { return frames.size() < max_queued_frames; });
+			frames.push_back({visible_world, std::move(draw_frame)});
+		}
+		frames_changed.notify_one();
+	}
+
 	void waitForPress() {
-		if (initialized) {
+		if (initialized && !recording) {
 			wait_for_proceed.wait();
 		}
 	}
 
 	void refresh() {
+		if (recording) {
+			return;
+		}
 		graphics::refresh_graphics();
 	}
 
 	void close() {
+		if (recording) {
+			{
+				std::lock_guard<std::mutex> lock(frames_mutex);
+				close_requested = true;
+			}
+			frames_changed.notify_one();
+			return;
+		}
 		close_requested = true;
 		graphics::simulate_proceed();
 	}
@@ -104,23 +188,27 @@ public:
 
 };
 
-void Graphics::waitForPress() {
+void Graphics::waitForPress_impl() {
 	if (impl) impl->waitForPress();
 }
 
-void Graphics::refresh() {
+void Graphics::recordFrame_impl(const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame) {
+	if (impl) impl->recordFrame(visible_world, std::move(draw_frame));
+}
+
+void Graphics::refresh_impl() {
 	if (impl) impl->refresh();
 }
 
-void Graphics::close() {
+void Graphics::close_impl() {
 	if (impl) impl->close();
 }
 
-void Graphics::join() {
+void Graphics::join_impl() {
 	if (impl) impl->join();
 }
 
-void Graphics::startThreadsAndOpenWindow() {
+void Graphics::startThreadsAndOpenWindow_impl() {
 	if (enabled && !impl) {
 		impl.reset(new Impl(this));
 	}
@@ -1,15 +1,31 @@
 #ifndef GRAHPCIS__GRAPHICS_WRAPPER_H
 #define GRAHPCIS__GRAPHICS_WRAPPER_H
 
+#include <graphics/geometry.hpp>
+
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace graphics {
 
+/**
+ * False in builds without graphics (NO_GRAPHICS, eg. BUILD_MODE=headless-release).
+ * Work done only to feed the graphics can be put under an `if` on this, and be compiled out.
+ */
+#ifdef NO_GRAPHICS
+	constexpr bool compiled_in = false;
+#else
+	constexpr bool compiled_in = true;
+#endif
+
 /**
  * The main API for making windows and graphics elements.
  */
 class Graphics {
 	bool enabled;
+	// non-empty if recording
+	std::string recording_file_prefix;
 	// PIMPL to keep windowing & drawing dependencies contained
 	class Impl;
 	std::unique_ptr<Impl> impl;
@@ -24,32 +40,61 @@ public:
 	void enable() { enabled = true; }
 	void disable() { enabled = false; }
 
+	/**
+	 * Record instead of showing a window: each frame given to recordFrame is drawn to
+	 * <file_prefix>NNNNNN.ps by a background thread, and waitForPress returns immediately.
+	 * No display is needed, but text isn't drawn. Not available without compiled_in.
+	 * Call instead of enable(), before startThreadsAndOpenWindow().
+	 */
+	void enableRecording(std::string file_prefix) {
+		enabled = true;
+		recording_file_prefix = std::move(file_prefix);
+	}
+
+	bool isRecording() const { return compiled_in && enabled && !recording_file_prefix.empty(); }
+	const std::string& recordingFilePrefix() const { return recording_file_prefix; }
+
+	/**
+	 * Queue draw_frame to be called, with visible_world in view, to draw the next recorded file.
+	 * Only blocks if many frames are already waiting to be drawn.
+	 * Frames still queued at close() are drawn before join() returns.
+	 */
+	void recordFrame(const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame) {
+		if (compiled_in) { recordFrame_impl(visible_world, std::move(draw_frame)); }
+	}
+
 	/**
 	 * Blocks until the ever-present proceed button is pressed.
-	 * Returns immediately if no graphics, or if the window with the continue
+	 * Returns immediately if no graphics, if recording, or if the window with the continue
 	 * button has been closed.
 	 */
-	void waitForPress();
+	void waitForPress() { if (compiled_in) { waitForPress_impl(); } }
 
 	/**
 	 * cause the screen to redraw
 	 */
-	void refresh();
+	void refresh() { if (compiled_in) { refresh_impl(); } }
 
 	/**
 	 * Exit the graphics. .join() will return soon after
 	 */
-	void close();
+	void close() { if (compiled_in) { close_impl(); } }
 
 	/**
 	 * Wait for all threads to exit and windows to close
 	 */
-	void join();
+	void join() { if (compiled_in) { join_impl(); } }
 
-	void startThreadsAndOpenWindow();
+	void startThreadsAndOpenWindow() { if (compiled_in) { startThreadsAndOpenWindow_impl(); } }
 
 	virtual void drawAll() { }
 private:
+	void waitForPress_impl();
+	void recordFrame_impl(const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame);
+	void refresh_impl();
+	void close_impl();
+	void join_impl();
+	void startThreadsAndOpenWindow_impl();
 };
 
 } // end namespace graphics
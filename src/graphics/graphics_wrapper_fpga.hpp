@@ -16,6 +16,24 @@ public:
 		: fpga_graphics_data()
 	{ }
 
+	void enable() {
+		Graphics::enable();
+		fpga_graphics_data.setKeepStates(true);
+	}
+
+	void enableRecording(std::string file_prefix) {
+		Graphics::enableRecording(std::move(file_prefix));
+		fpga_graphics_data.setKeepStates(true);
+		fpga_graphics_data.setRecorder([this](const geom::BoundBox<float>& visible_world, std::function<void()> draw_frame) {
+			recordFrame(visible_world, std::move(draw_frame));
+		});
+	}
+
+	void disable() {
+		Graphics::disable();
+		fpga_graphics_data.setKeepStates(false);
+	}
+
 	void drawAll() override {
 		fpga_graphics_data.drawAll();
 	}
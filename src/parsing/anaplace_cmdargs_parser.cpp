@@ -2,6 +2,7 @@
 #include "anaplace_cmdargs_parser.hpp"
 
 #include <device/connectors.hpp>
+#include <graphics/graphics_wrapper.hpp>
 
 #include <unordered_set>
 
@@ -16,6 +17,10 @@ namespace cmdargs {
 MetaConfig::MetaConfig()
 	: levels_to_enable(DebugLevel::getDefaultSet())
 	, graphics_enabled(false)
+	, graphics_recording_prefix()
+	, async_logging(false)
+	, memory_report(false)
+	, profile_trace_file_name()
 { }
 
 ProgramConfig::ProgramConfig()
@@ -34,7 +39,11 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 
 	metaopts.add_options()
 		("graphics", po::bool_switch(&m_meta.graphics_enabled), "Enable graphics")
+		("record-graphics", po::value(&m_meta.graphics_recording_prefix), "Instead of showing a window, draw each graphics state to <this>NNNNNN.ps from a background thread, without waiting")
 		("debug",    "Turn on the most common debugging options")
+		("async-log", po::bool_switch(&m_meta.async_logging), "Write the log from a background thread")
+		("profile",  po::value(&m_meta.profile_trace_file_name), "Profile the titled scopes, writing a Chrome trace here and a summary at the end")
+		("memory-report", po::bool_switch(&m_meta.memory_report), "Record the sizes of the major data structures, and print them with the peak RSS at the end")
 	;
 	DebugLevel::forEachLevel([&](DebugLevel::Level l) {
 		metaopts.add_options()(("DL::" + DebugLevel::getAsString(l)).c_str(), "debug flag");
@@ -60,6 +69,12 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 
 	po::notify(vm);
 
+	if (!graphics::compiled_in && vm.count("record-graphics")) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "--record-graphics isn't available in a build without graphics";
+		});
+	}
+
 	if (vm.count("debug")) {
 		auto debug_levels = DebugLevel::getStandardDebug();
 		m_meta.levels_to_enable.insert(end(m_meta.levels_to_enable),begin(debug_levels),end(debug_levels));
@@ -27,6 +27,10 @@ struct MetaConfig {
 	}
 
 	bool shouldEnableGraphics() const  { return graphics_enabled; }
+	const std::string& getGraphicsRecordingPrefix() const { return graphics_recording_prefix; }
+	bool shouldLogAsynchronously() const { return async_logging; }
+	bool shouldReportMemory() const { return memory_report; }
+	const std::string& getProfileTraceFileName() const { return profile_trace_file_name; }
 
 private:
 	friend struct ParsedArguments;
@@ -37,6 +41,18 @@ private:
 	/// The printing levels that should be enabled. Duplicate entries are possible & allowed
 	std::vector<DebugLevel::Level> levels_to_enable;
 	bool graphics_enabled;
+
+	/// render each graphics state to files starting with this, instead of showing a window. Empty if not recording
+	std::string graphics_recording_prefix;
+
+	/// write dout's output from a background thread
+	bool async_logging;
+
+	/// record the sizes of the major data structures, and print them with the RSS at the end
+	bool memory_report;
+
+	/// where to write a Chrome trace of the profiled scopes. Empty if not profiling
+	std::string profile_trace_file_name;
 };
 
 struct ProgramConfig {
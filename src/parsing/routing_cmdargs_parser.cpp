@@ -2,7 +2,9 @@
 #include "routing_cmdargs_parser.hpp"
 
 #include <device/connectors.hpp>
+#include <graphics/graphics_wrapper.hpp>
 
+#include <algorithm>
 #include <unordered_set>
 
 namespace parsing {
@@ -13,12 +15,26 @@ namespace cmdargs {
 
 ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 	: graphics_enabled(false)
+	, graphics_recording_prefix()
+	, async_logging(false)
+	, memory_report(false)
 	, fanout_test(false)
 	, route_as_is(false)
 	, channel_width_override(boost::none)
 	, device_type_override(boost::none)
 	, levels_to_enable(DebugLevel::getDefaultSet())
+	, profile_trace_file_name()
 	, data_file_name()
+	, rr_graph_cache_dir()
+	, batch_manifest()
+	, batch_results_file_name()
+	, sweep_grid_file_name()
+	, sweep_results_file_name()
+	, num_concurrent_sweep_runs(1)
+	, checkpoint_file_name()
+	, resume(false)
+	, route_stats_file_name()
+	, eco_file_name()
 	, m_nThreads(2)
  {
 	uint arg_count = argc_int;
@@ -38,6 +54,42 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 		}
 	}
 
+	{
+		auto record_flag_it = std::find(begin(args),end(args),"--record-graphics");
+		if (record_flag_it != end(args)) {
+			auto record_prefix_it = std::next(record_flag_it);
+			if (record_prefix_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--record-graphics requires an argument";
+				});
+			} else if (!graphics::compiled_in) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--record-graphics isn't available in a build without graphics";
+				});
+			} else {
+				graphics_recording_prefix = *record_prefix_it;
+				used.insert(std::distance(begin(args), record_flag_it));
+				used.insert(std::distance(begin(args), record_prefix_it));
+			}
+		}
+	}
+
+	{
+		const auto arg_it = std::find(begin(args),end(args),"--async-log");
+		if (arg_it != end(args)) {
+			async_logging = true;
+			used.insert(std::distance(begin(args), arg_it));
+		}
+	}
+
+	{
+		const auto arg_it = std::find(begin(args),end(args),"--memory-report");
+		if (arg_it != end(args)) {
+			memory_report = true;
+			used.insert(std::distance(begin(args), arg_it));
+		}
+	}
+
 	{
 		const auto arg_it = std::find(begin(args),end(args),"--debug");
 		if (arg_it != end(args)) {
@@ -86,9 +138,78 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 		}
 	}
 
+	{
+		auto sweep_flag_it = std::find(begin(args),end(args),"--sweep");
+		if (sweep_flag_it != end(args)) {
+			auto grid_file_it = std::next(sweep_flag_it);
+			if (grid_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep requires an argument";
+				});
+			} else if (graphics_enabled || !graphics_recording_prefix.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep can't be used with --graphics or --record-graphics";
+				});
+			} else {
+				sweep_grid_file_name = *grid_file_it;
+				used.insert(std::distance(begin(args), sweep_flag_it));
+				used.insert(std::distance(begin(args), grid_file_it));
+			}
+		}
+	}
+
+	{
+		auto results_flag_it = std::find(begin(args),end(args),"--sweep-results");
+		if (results_flag_it != end(args)) {
+			auto results_file_it = std::next(results_flag_it);
+			if (results_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep-results requires an argument";
+				});
+			} else if (sweep_grid_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep-results only makes sense with --sweep";
+				});
+			} else {
+				sweep_results_file_name = *results_file_it;
+				used.insert(std::distance(begin(args), results_flag_it));
+				used.insert(std::distance(begin(args), results_file_it));
+			}
+		}
+	}
+
+	{
+		auto jobs_flag_it = std::find(begin(args),end(args),"--sweep-jobs");
+		if (jobs_flag_it != end(args)) {
+			auto jobs_number_it = std::next(jobs_flag_it);
+			if (jobs_number_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep-jobs requires an argument";
+				});
+			} else if (sweep_grid_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--sweep-jobs only makes sense with --sweep";
+				});
+			} else {
+				std::size_t pos = jobs_number_it->size();
+				auto result = std::stoi(*jobs_number_it, &pos);
+				if (pos != jobs_number_it->size() || result < 1) {
+					util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+						str << "--sweep-jobs argument is malformed";
+					});
+				}
+				num_concurrent_sweep_runs = result;
+				used.insert(std::distance(begin(args), jobs_flag_it));
+				used.insert(std::distance(begin(args), jobs_number_it));
+			}
+		}
+	}
+
 	{
 		auto dto_flag_it = std::find(begin(args),end(args),"--device-type-override");
-		if (dto_flag_it == end(args)) {
+		if (dto_flag_it == end(args) && !sweep_grid_file_name.empty()) {
+			// the device types come from the sweep grid
+		} else if (dto_flag_it == end(args)) {
 			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
 				str << "--device-type-override required";
 			});
@@ -133,9 +254,47 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 		}
 	}
 
+	{
+		auto batch_flag_it = std::find(begin(args),end(args),"--batch");
+		if (batch_flag_it != end(args)) {
+			auto manifest_it = std::next(batch_flag_it);
+			if (manifest_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--batch requires an argument";
+				});
+			} else {
+				batch_manifest = *manifest_it;
+				used.insert(std::distance(begin(args), batch_flag_it));
+				used.insert(std::distance(begin(args), manifest_it));
+			}
+		}
+	}
+
+	{
+		auto results_flag_it = std::find(begin(args),end(args),"--batch-results");
+		if (results_flag_it != end(args)) {
+			auto results_file_it = std::next(results_flag_it);
+			if (results_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--batch-results requires an argument";
+				});
+			} else if (batch_manifest.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--batch-results only makes sense with --batch";
+				});
+			} else {
+				batch_results_file_name = *results_file_it;
+				used.insert(std::distance(begin(args), results_flag_it));
+				used.insert(std::distance(begin(args), results_file_it));
+			}
+		}
+	}
+
 	{
 		auto data_flag_it = std::find(begin(args),end(args),"--data-file");
-		if (data_flag_it == end(args)) {
+		if (data_flag_it == end(args) && (!batch_manifest.empty() || !sweep_grid_file_name.empty())) {
+			// the data files come from the batch manifest or sweep grid
+		} else if (data_flag_it == end(args)) {
 			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
 				str << "--data-file is required";
 			});
@@ -153,6 +312,111 @@ ParsedArguments::ParsedArguments(int argc_int, char const** argv)
 		}
 	}
 
+	{
+		auto checkpoint_flag_it = std::find(begin(args),end(args),"--checkpoint");
+		if (checkpoint_flag_it != end(args)) {
+			auto checkpoint_file_it = std::next(checkpoint_flag_it);
+			if (checkpoint_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--checkpoint requires an argument";
+				});
+			} else if (!batch_manifest.empty() || !sweep_grid_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--checkpoint can't be used with --batch or --sweep";
+				});
+			} else {
+				checkpoint_file_name = *checkpoint_file_it;
+				used.insert(std::distance(begin(args), checkpoint_flag_it));
+				used.insert(std::distance(begin(args), checkpoint_file_it));
+			}
+		}
+	}
+
+	{
+		const auto arg_it = std::find(begin(args),end(args),"--resume");
+		if (arg_it != end(args)) {
+			if (checkpoint_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--resume requires --checkpoint";
+				});
+			}
+			resume = true;
+			used.insert(std::distance(begin(args), arg_it));
+		}
+	}
+
+	{
+		auto eco_flag_it = std::find(begin(args),end(args),"--eco");
+		if (eco_flag_it != end(args)) {
+			auto eco_file_it = std::next(eco_flag_it);
+			if (eco_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--eco requires an argument";
+				});
+			} else if (!batch_manifest.empty() || !sweep_grid_file_name.empty() || !checkpoint_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--eco can't be used with --batch, --sweep or --checkpoint";
+				});
+			} else {
+				eco_file_name = *eco_file_it;
+				used.insert(std::distance(begin(args), eco_flag_it));
+				used.insert(std::distance(begin(args), eco_file_it));
+			}
+		}
+	}
+
+	{
+		auto profile_flag_it = std::find(begin(args),end(args),"--profile");
+		if (profile_flag_it != end(args)) {
+			auto profile_file_it = std::next(profile_flag_it);
+			if (profile_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--profile requires an argument";
+				});
+			} else {
+				profile_trace_file_name = *profile_file_it;
+				used.insert(std::distance(begin(args), profile_flag_it));
+				used.insert(std::distance(begin(args), profile_file_it));
+			}
+		}
+	}
+
+	{
+		auto stats_flag_it = std::find(begin(args),end(args),"--route-stats");
+		if (stats_flag_it != end(args)) {
+			auto stats_file_it = std::next(stats_flag_it);
+			if (stats_file_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--route-stats requires an argument";
+				});
+			} else if (!sweep_grid_file_name.empty()) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--route-stats can't be used with --sweep";
+				});
+			} else {
+				route_stats_file_name = *stats_file_it;
+				used.insert(std::distance(begin(args), stats_flag_it));
+				used.insert(std::distance(begin(args), stats_file_it));
+			}
+		}
+	}
+
+	{
+		auto cache_dir_flag_it = std::find(begin(args),end(args),"--rr-graph-cache-dir");
+		if (cache_dir_flag_it != end(args)) {
+			auto cache_dir_it = std::next(cache_dir_flag_it);
+			if (cache_dir_it == end(args)) {
+				util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+					str << "--rr-graph-cache-dir requires an argument";
+				});
+			} else {
+				rr_graph_cache_dir = *cache_dir_it;
+				used.insert(std::distance(begin(args), cache_dir_flag_it));
+				used.insert(std::distance(begin(args), cache_dir_it));
+			}
+		}
+	}
+
 	{
 		auto thread_flag_it = std::find(begin(args),end(args),"--num-threads");
 		if (thread_flag_it != end(args)) {
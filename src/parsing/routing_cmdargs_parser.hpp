@@ -29,17 +29,40 @@ public:
 	 * Should the current invocation of the program display graphics?
 	 */
 	bool shouldEnableGraphics() const  { return graphics_enabled; }
+	const std::string& getGraphicsRecordingPrefix() const { return graphics_recording_prefix; }
+	bool shouldLogAsynchronously() const { return async_logging; }
+	bool shouldReportMemory() const { return memory_report; }
+	const std::string& getProfileTraceFileName() const { return profile_trace_file_name; }
 	bool shouldDoFanoutTest() const { return fanout_test; }
 	bool shouldJustRouteAsIs() const { return route_as_is; }
 	const auto& deviceTypeOverride() const { return device_type_override; }
 	const boost::optional<int>& channelWidthOverride() const { return channel_width_override; }
 	const std::string& getDataFileName() const { return data_file_name; }
+	const std::string& getRRGraphCacheDir() const { return rr_graph_cache_dir; }
+	const std::string& getBatchManifest() const { return batch_manifest; }
+	const std::string& getBatchResultsFileName() const { return batch_results_file_name; }
+	const std::string& getSweepGridFileName() const { return sweep_grid_file_name; }
+	const std::string& getSweepResultsFileName() const { return sweep_results_file_name; }
+	const std::string& getCheckpointFileName() const { return checkpoint_file_name; }
+	bool shouldResume() const { return resume; }
+	const std::string& getRouteStatsFileName() const { return route_stats_file_name; }
+	const std::string& getEcoFileName() const { return eco_file_name; }
+	int numConcurrentSweepRuns() const { return num_concurrent_sweep_runs; }
 	int nThreads() const { return m_nThreads; }
 
 private:
 	friend ParsedArguments parse(int arc_int, char const** argv);
 
 	bool graphics_enabled;
+
+	/// render each graphics state to files starting with this, instead of showing a window. Empty if not recording
+	std::string graphics_recording_prefix;
+
+	/// write dout's output from a background thread
+	bool async_logging;
+
+	/// record the sizes of the major data structures, and print them with the RSS at the end
+	bool memory_report;
 	bool fanout_test;
 	bool route_as_is;
 	boost::optional<int> channel_width_override;
@@ -48,8 +71,42 @@ private:
 	/// The printing levels that should be enabled. Duplicate entries are possible & allowed
 	std::vector<DebugLevel::Level> levels_to_enable;
 
+	/// where to write a Chrome trace of the profiled scopes. Empty if not profiling
+	std::string profile_trace_file_name;
+
 	std::string data_file_name;
 
+	/// where to keep routing-resource graph files. Empty if not given
+	std::string rr_graph_cache_dir;
+
+	/// file listing data files to route one after the other ("-" for stdin). Empty if not given
+	std::string batch_manifest;
+
+	/// where to write the per-job results of a batch. Empty for stdout
+	std::string batch_results_file_name;
+
+	/// file describing the parameter grid of a sweep. Empty if not given
+	std::string sweep_grid_file_name;
+
+	/// where to write the per-run CSV of a sweep. Empty for stdout
+	std::string sweep_results_file_name;
+
+	/// how many sweep runs go at once. 1 unless asked, so that each run's time isn't
+	/// affected by what the others are doing
+	int num_concurrent_sweep_runs;
+
+	/// where to save the progress of the track width exploration. Empty if not given
+	std::string checkpoint_file_name;
+
+	/// start from what's already in the checkpoint file
+	bool resume;
+
+	/// where to write the maze router's search stats at the end (CSV if it ends in .csv, otherwise JSON). Empty if not given
+	std::string route_stats_file_name;
+
+	/// an engineering change to route incrementally, after routing the data file as-is. Empty if not given
+	std::string eco_file_name;
+
 	int m_nThreads;
 
 	ParsedArguments(int arc_int, char const** argv);
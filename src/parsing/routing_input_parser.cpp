@@ -1,94 +1,242 @@
 #include "routing_input_parser.hpp"
 
 #include <util/logging.hpp>
-#include <util/iteration_utils.hpp>
+#include <util/mapped_file.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
-#include <boost/fusion/adapted/boost_tuple.hpp>
-#include <boost/fusion/include/adapt_struct.hpp>
-#include <boost/fusion/tuple.hpp>
-
-#ifndef ECF_BOOST_COMPAT
-	#include <boost/spirit/home/x3.hpp>
-#else
-	#include <boost/spirit/include/qi.hpp>
-	#include <boost/spirit/include/phoenix_core.hpp>
-	#include <boost/spirit/include/phoenix_operator.hpp>
-	#define x3 qi // please be lenient...
-#endif
-
 namespace parsing {
 namespace routing {
 namespace input {
 
-boost::variant<ParseResult, std::string> parse_data(std::istream& is, boost::optional<device::DeviceTypeID> default_device_type) {
-	std::stringstream is_as_ss;
-	is_as_ss << is.rdbuf();
-	auto is_as_string = is_as_ss.str();
+namespace {
 
-	auto indent = dout(DL::DATA_READ1).indentWithTitle("Reading Data");
+/**
+ * Reads the format directly out of a buffer - no copies, no intermediate
+ * tuples - keeping track of where it is so that errors can say so.
+ *
+ * The format is: the grid size and the track width on their own lines, then lines
+ * of six integers (source x y pin, sink x y pin). The first line with a negative
+ * source x ends the connections. Anything after that is checked but ignored.
+ */
+class Scanner {
+public:
+	Scanner(const char* begin, const char* end)
+		: curr(begin)
+		, last(end)
+		, line_begin(begin)
+		, line_number(1)
+		, error()
+	{ }
+
+	Scanner(const Scanner&) = delete;
+	Scanner& operator=(const Scanner&) = delete;
+
+	bool at_end() const { return curr == last; }
+
+	const std::string& getError() const { return error; }
+
+	void skip_blanks() {
+		while (curr != last && (*curr == ' ' || *curr == '\t' || *curr == '\r')) {
+			++curr;
+		}
+	}
+
+	void skip_whitespace() {
+		while (curr != last && (*curr == ' ' || *curr == '\t' || *curr == '\r' || *curr == '\n')) {
+			if (*curr == '\n') {
+				next_line();
+			} else {
+				++curr;
+			}
+		}
+	}
+
+	bool at_end_of_line() {
+		skip_blanks();
+		return curr == last || *curr == '\n';
+	}
+
+	/**
+	 * Consume the end of the current line (or of the file)
+	 */
+	bool end_line() {
+		if (!at_end_of_line()) {
+			return fail("expected the end of the line");
+		}
+		if (curr != last) {
+			next_line();
+		}
+		return true;
+	}
+
+	/**
+	 * Read one of the characters in `chars`
+	 */
+	bool one_of(const char* chars, char& result) {
+		skip_blanks();
+		if (curr == last || *curr == '\n' || std::strchr(chars, *curr) == nullptr) {
+			std::string what = "expected one of: ";
+			what += chars;
+			return fail(what.c_str());
+		}
+		result = *curr;
+		++curr;
+		return true;
+	}
+
+	template<typename Integer>
+	bool integer(Integer& result) {
+		skip_blanks();
+		const bool negative = curr != last && *curr == '-';
+		const auto digits_begin = negative ? std::next(curr) : curr;
+
+		std::int64_t value = 0;
+		auto it = digits_begin;
+		for (; it != last && '0' <= *it && *it <= '9'; ++it) {
+			value = value*10 + (*it - '0');
+			if (value > std::numeric_limits<std::int32_t>::max()) {
+				return fail("number is too big");
+			}
+		}
 
-	namespace x3 = boost::spirit::x3;
-	namespace chars = boost::spirit::x3::ascii;
+		if (it == digits_begin) {
+			return fail("expected an integer");
+		}
+
+		value = negative ? -value : value;
+		if (value < std::numeric_limits<Integer>::min() || std::numeric_limits<Integer>::max() < value) {
+			return fail("number is out of range");
+		}
+
+		result = static_cast<Integer>(value);
+		curr = it;
+		return true;
+	}
+
+	bool fail(const char* what) {
+		std::ostringstream os;
+		os << "line " << line_number << ", column " << (curr - line_begin) + 1 << ": " << what;
+		if (curr == last) {
+			os << ", at the end of the file";
+		} else if (*curr == '\n') {
+			os << ", at the end of the line";
+		} else {
+			os << ", at: " << std::string(curr, std::find(curr, curr + std::min<std::ptrdiff_t>(last - curr, 40), '\n'));
+		}
+		error = os.str();
+		return false;
+	}
+
+private:
+	void next_line() {
+		++curr;
+		line_begin = curr;
+		line_number += 1;
+	}
+
+	const char* curr;
+	const char* const last;
+	const char* line_begin;
+	int line_number;
+	std::string error;
+};
+
+/**
+ * Read the rest of a line with a connection on it (source x y pin, sink x y pin).
+ * A negative source x makes it a terminator, rather than a connection.
+ */
+bool connection_line(Scanner& scanner, std::pair<device::PinGID, device::PinGID>& connection, bool& is_terminator) {
 	using device::XID;
 	using device::YID;
 	using device::BlockPinID;
 	using device::BlockID;
 	using device::PinGID;
 
-	boost::tuple<int, int, std::vector< boost::tuple<
-		XID::IDType, YID::IDType, BlockPinID::IDType, XID::IDType, YID::IDType, BlockPinID::IDType
-	> > > parse_results;
+	XID::IDType src_x = 0, sink_x = 0;
+	YID::IDType src_y = 0, sink_y = 0;
+	BlockPinID::IDType src_pin = 0, sink_pin = 0;
+	if (
+		   !scanner.integer(src_x) || !scanner.integer(src_y) || !scanner.integer(src_pin)
+		|| !scanner.integer(sink_x) || !scanner.integer(sink_y) || !scanner.integer(sink_pin)
+		|| !scanner.end_line()
+	) {
+		return false;
+	}
+
+	is_terminator = src_x < 0;
+	if (!is_terminator) {
+		connection = {
+			util::make_id<PinGID>(
+				util::make_id<BlockID>(util::make_id<XID>(src_x), util::make_id<YID>(src_y)),
+				util::make_id<BlockPinID>(src_pin)
+			),
+			util::make_id<PinGID>(
+				util::make_id<BlockID>(util::make_id<XID>(sink_x), util::make_id<YID>(sink_y)),
+				util::make_id<BlockPinID>(sink_pin)
+			),
+		};
+	}
+	return true;
+}
+
+boost::variant<ParseResult, std::string> parse_buffer(const char* begin, const char* end, boost::optional<device::DeviceTypeID> default_device_type) {
+	auto indent = dout(DL::DATA_READ1).indentWithTitle("Reading Data");
 
-	auto it = begin(is_as_string);
-	const auto it_end = end(is_as_string);
-	const bool is_match = x3::phrase_parse( it, it_end,
-		x3::int_ >> '\n' >> x3::int_ >> '\n' >> (
-			x3::short_ >> x3::short_ >> x3::short_ >> x3::short_ >> x3::short_ >> x3::short_
-		) % '\n' >> x3::omit[*chars::space],
-		x3::lit(' '),
-		parse_results
-	);
+	using device::PinGID;
 
-	using std::begin;
-	using std::end;
+	Scanner scanner(begin, end);
+
+	int grid_size = 0;
+	int track_width = 0;
+	if (!scanner.integer(grid_size) || !scanner.end_line() || !scanner.integer(track_width) || !scanner.end_line()) {
+		return scanner.getError();
+	}
 
 	device::DeviceInfo device_info{
 		*default_device_type,
-		geom::BoundBox<int>(0,0,boost::get<0>(parse_results)-1,boost::get<0>(parse_results)-1),
-		boost::get<1>(parse_results),
+		geom::BoundBox<int>(0,0,grid_size-1,grid_size-1),
+		track_width,
 		1,
 		2,
 	};
 
 	util::Netlist<PinGID> netlist;
 	decltype(ParseResult::pin_order_in_input) pin_order_in_input;
+	// a connection's line is at least 12 characters ("0 0 0 0 0 0\n"), so this is enough, without reading the file an extra time
+	const std::size_t shortest_connection_line = 12;
+	pin_order_in_input.reserve(static_cast<std::size_t>(end - begin)/shortest_connection_line);
 
-	for (const auto& route_request_parse : boost::get<2>(parse_results)) {
-
-		if (boost::get<0>(route_request_parse) < 0) {
+	bool seen_terminator = false;
+	while (true) {
+		scanner.skip_whitespace();
+		if (scanner.at_end()) {
 			break;
 		}
 
-		pin_order_in_input.emplace_back(
-			util::make_id<PinGID>(
-				util::make_id<BlockID>(
-					util::make_id<XID>(boost::get<0>(route_request_parse)),
-					util::make_id<YID>(boost::get<1>(route_request_parse))
-				),
-				util::make_id<BlockPinID>(boost::get<2>(route_request_parse))
-			),
-			util::make_id<PinGID>(
-				util::make_id<BlockID>(
-					util::make_id<XID>(boost::get<3>(route_request_parse)),
-					util::make_id<YID>(boost::get<4>(route_request_parse))
-				),
-				util::make_id<BlockPinID>(boost::get<5>(route_request_parse))
-			)
-		);
+		std::pair<PinGID, PinGID> connection;
+		bool is_terminator = false;
+		if (!connection_line(scanner, connection, is_terminator)) {
+			return scanner.getError();
+		}
+
+		if (is_terminator) {
+			seen_terminator = true;
+		}
+		if (seen_terminator) {
+			continue;
+		}
+
+		pin_order_in_input.push_back(connection);
 
 		netlist.addConnection(
 			pin_order_in_input.back().first,
@@ -96,22 +244,65 @@ boost::variant<ParseResult, std::string> parse_data(std::istream& is, boost::opt
 		);
 	}
 
-	const bool matches_full = is_match && it == it_end;
-	if (!matches_full) {
-		auto err_stream = std::stringstream();
-		err_stream << "junk at end of file: ";
-		int count = 0;
-		for (auto& c : util::make_iterable(std::make_pair(it, it_end))) {
-			err_stream << c;
-			if (count > 100) {
-				err_stream << " ...";
-				break;
-			}
+	return ParseResult{device_info, std::move(netlist), std::move(pin_order_in_input)};
+}
+
+} // end anonymous namespace
+
+boost::variant<ParseResult, std::string> parse_data(std::istream& is, boost::optional<device::DeviceTypeID> default_device_type) {
+	const std::string contents{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+	return parse_buffer(contents.data(), contents.data() + contents.size(), default_device_type);
+}
+
+boost::variant<ParseResult, std::string> parse_data_file(const std::string& file_name, boost::optional<device::DeviceTypeID> default_device_type) {
+	const util::MappedFile mapped_file(file_name);
+	return parse_buffer(mapped_file.data(), mapped_file.data() + mapped_file.size(), default_device_type);
+}
+
+boost::variant<EcoParseResult, std::string> parse_eco_file(const std::string& file_name) {
+	auto indent = dout(DL::DATA_READ1).indentWithTitle("Reading Engineering Change");
+
+	const util::MappedFile mapped_file(file_name);
+	Scanner scanner(mapped_file.data(), mapped_file.data() + mapped_file.size());
+
+	EcoParseResult result;
+	while (true) {
+		scanner.skip_whitespace();
+		if (scanner.at_end()) {
+			break;
 		}
-		return err_stream.str();
+
+		char added_or_removed = '\0';
+		std::pair<device::PinGID, device::PinGID> connection;
+		bool is_terminator = false;
+		if (!scanner.one_of("+-", added_or_removed) || !connection_line(scanner, connection, is_terminator)) {
+			return scanner.getError();
+		}
+		if (is_terminator) {
+			continue; // eg. a connection copied from a data file's last line
+		}
+
+		(added_or_removed == '+' ? result.added : result.removed).push_back(connection);
+	}
+
+	return result;
+}
+
+void write_data(std::ostream& os, const device::DeviceInfo& device_info, const std::vector<std::pair<device::PinGID, device::PinGID>>& connections) {
+	os << device_info.bounds.get_width() + 1 << '\n';
+	os << device_info.track_width << '\n';
+
+	const auto write_pin = [&](const device::PinGID& pin) {
+		os << pin.getBlock().getX().getValue() << ' ' << pin.getBlock().getY().getValue() << ' ' << pin.getBlockPin().getValue();
+	};
+	for (const auto& connection : connections) {
+		write_pin(connection.first);
+		os << ' ';
+		write_pin(connection.second);
+		os << '\n';
 	}
 
-	return ParseResult{device_info, netlist, pin_order_in_input};
+	os << "-1 -1 -1 -1 -1 -1\n";
 }
 
 }
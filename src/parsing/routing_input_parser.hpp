@@ -5,6 +5,7 @@
 #include <util/netlist.hpp>
 
 #include <iosfwd>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -22,10 +23,35 @@ struct ParseResult {
 };
 
 /**
- * returns the input data for the program to work on
+ * returns the input data for the program to work on, or a description of
+ * what's wrong with it (with a line and column)
  */
 boost::variant<ParseResult, std::string> parse_data(std::istream& is, boost::optional<device::DeviceTypeID> default_device_type);
 
+/**
+ * The same as parse_data, but reads the file in place through a memory
+ * mapping rather than copying it. Throws if the file can't be mapped.
+ */
+boost::variant<ParseResult, std::string> parse_data_file(const std::string& file_name, boost::optional<device::DeviceTypeID> default_device_type);
+
+struct EcoParseResult {
+	std::vector<std::pair<device::PinGID, device::PinGID>> added = {};
+	std::vector<std::pair<device::PinGID, device::PinGID>> removed = {};
+};
+
+/**
+ * Reads an engineering change: lines of '+' or '-' (for added or removed) followed by
+ * a connection, as parse_data reads them. Returns the connections, or a description of
+ * what's wrong with the file (with a line and column).
+ */
+boost::variant<EcoParseResult, std::string> parse_eco_file(const std::string& file_name);
+
+/**
+ * Writes connections in the format parse_data reads, so that
+ * parse_data gives back the same device and connections (in the same order).
+ */
+void write_data(std::ostream& os, const device::DeviceInfo& device_info, const std::vector<std::pair<device::PinGID, device::PinGID>>& connections);
+
 } // end namespace parsing
 } // end namespace routing
 } // end namespace input
@@ -1,13 +1,18 @@
 
+#include <device/rr_graph_file.hpp>
 #include <flows/routing_flows.hpp>
+#include <flows/routing_sweep.hpp>
 #include <graphics/graphics_wrapper_fpga.hpp>
 #include <parsing/routing_cmdargs_parser.hpp>
 #include <parsing/routing_input_parser.hpp>
 #include <util/lambda_compose.hpp>
 #include <util/logging.hpp>
+#include <util/memory_usage.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <thread>
 
@@ -19,12 +24,33 @@ struct ProgramConfig {
 	bool route_as_is;
 	boost::optional<int> channel_width_override;
 	boost::optional<device::DeviceTypeID> device_type_override;
+	std::string rr_graph_cache_dir;
+	std::string batch_manifest;
+	std::string batch_results_file_name;
+	std::string sweep_grid_file_name;
+	std::string sweep_results_file_name;
+	int num_concurrent_sweep_runs;
+	std::string checkpoint_file_name;
+	bool resume;
+	std::string route_stats_file_name;
+	std::string eco_file_name;
 	int nThreads;
 };
 
+struct JobResult {
+	bool routed;
+	boost::optional<int> track_width;
+};
+
 using namespace parsing::routing;
 
 int program_main(const ProgramConfig& config);
+int batch_main(const ProgramConfig& config);
+int sweep_main(const ProgramConfig& config);
+JobResult route_data_file(const ProgramConfig& config, algo::MazeRouteStats* route_stats);
+algo::NetlistDelta read_eco_file(const std::string& eco_file_name);
+void write_route_stats(const ProgramConfig& config, const algo::MazeRouteStats& route_stats);
+std::string quoted_for_json(const std::string& str);
 
 void do_optional_input_data_dump(const std::string& data_file_name, const input::ParseResult& pr);
 
@@ -38,34 +64,201 @@ int main(int argc, char const** argv) {
 		dout.enable_level(l);
 	}
 
+	// so that batch or sweep results on stdout are only the results
+	if (
+		(!parsed_args.getBatchManifest().empty() && parsed_args.getBatchResultsFileName().empty())
+		|| (!parsed_args.getSweepGridFileName().empty() && parsed_args.getSweepResultsFileName().empty())
+	) {
+		dout.setOutput(std::cerr);
+	}
+
+	if (parsed_args.shouldLogAsynchronously()) {
+		dout.startAsyncWriter();
+	}
+
+	if (!parsed_args.getProfileTraceFileName().empty()) {
+		util::Profiler::get().enable();
+	}
+
+	if (parsed_args.shouldReportMemory()) {
+		util::MemoryLedger::get().enable();
+	}
+
 	// enable graphics
-	if (parsed_args.shouldEnableGraphics()) {
+	if (!parsed_args.getGraphicsRecordingPrefix().empty()) {
+		graphics::get().enableRecording(parsed_args.getGraphicsRecordingPrefix());
+		graphics::get().startThreadsAndOpenWindow();
+	} else if (parsed_args.shouldEnableGraphics()) {
 		graphics::get().enable();
 		graphics::get().startThreadsAndOpenWindow();
 	}
 
-	const auto result = program_main(ProgramConfig{
+	const auto config = ProgramConfig{
 		parsed_args.getDataFileName(),
 		parsed_args.shouldDoFanoutTest(),
 		parsed_args.shouldJustRouteAsIs(),
 		parsed_args.channelWidthOverride(),
 		parsed_args.deviceTypeOverride(),
+		parsed_args.getRRGraphCacheDir(),
+		parsed_args.getBatchManifest(),
+		parsed_args.getBatchResultsFileName(),
+		parsed_args.getSweepGridFileName(),
+		parsed_args.getSweepResultsFileName(),
+		parsed_args.numConcurrentSweepRuns(),
+		parsed_args.getCheckpointFileName(),
+		parsed_args.shouldResume(),
+		parsed_args.getRouteStatsFileName(),
+		parsed_args.getEcoFileName(),
 		parsed_args.nThreads()
-	});
+	};
+
+	const auto result =
+		!config.sweep_grid_file_name.empty() ? sweep_main(config) :
+		!config.batch_manifest.empty() ? batch_main(config) :
+		program_main(config);
 
 	graphics::get().close();
 	graphics::get().join();
 
+	if (!parsed_args.getProfileTraceFileName().empty()) {
+		util::write_profile_report(parsed_args.getProfileTraceFileName());
+	}
+
+	if (parsed_args.shouldReportMemory()) {
+		util::write_memory_report();
+	}
+
+	dout.stopAsyncWriter();
+
 	return result;
 }
 
 int program_main(const ProgramConfig& config) {
 
-	std::ifstream data_file(config.data_file_name);
+	device::rr_graph_file::cacheDirectory() = config.rr_graph_cache_dir;
+
+	algo::MazeRouteStats route_stats;
+	route_data_file(config, &route_stats);
+	write_route_stats(config, route_stats);
+
+	return 0;
+}
+
+/**
+ * Route each data file listed in the manifest (one per line, blank lines and
+ * lines starting with '#' ignored) in this one process, so that devices are
+ * built once per configuration rather than once per circuit. Writes one JSON
+ * object per line for each job, as soon as it finishes. When those go to stdout,
+ * the log goes to stderr.
+ */
+int batch_main(const ProgramConfig& config) {
+
+	device::rr_graph_file::cacheDirectory() = config.rr_graph_cache_dir;
+	flows::keep_devices_warm();
+
+	std::ifstream manifest_file;
+	if (config.batch_manifest != "-") {
+		manifest_file.open(config.batch_manifest);
+		if (!manifest_file) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+				str << "couldn't open batch manifest " << config.batch_manifest;
+			});
+		}
+	}
+	std::istream& manifest = config.batch_manifest == "-" ? std::cin : manifest_file;
 
-	auto parse_result = input::parse_data(data_file, config.device_type_override);
-	auto visitor = util::compose_withbase<boost::static_visitor<void>>(
-		[&](const std::string& err_str) {
+	std::ofstream results_file;
+	if (!config.batch_results_file_name.empty()) {
+		results_file.open(config.batch_results_file_name);
+		if (!results_file) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+				str << "couldn't open batch results file " << config.batch_results_file_name;
+			});
+		}
+	}
+	std::ostream& results = config.batch_results_file_name.empty() ? std::cout : results_file;
+
+	algo::MazeRouteStats route_stats; // over all the jobs
+	int job_number = 0;
+	int num_errored_jobs = 0;
+	std::string line;
+	while (std::getline(manifest, line)) {
+		const auto first_char = line.find_first_not_of(" \t\r");
+		const auto last_char = line.find_last_not_of(" \t\r");
+		if (first_char == std::string::npos || line[first_char] == '#') {
+			continue;
+		}
+
+		auto job_config = config;
+		job_config.data_file_name = line.substr(first_char, last_char - first_char + 1);
+
+		const auto indent = dout(DL::INFO).indentWithTitle([&](auto&& str) {
+			str << "Batch Job " << job_number << " ( " << job_config.data_file_name << " )";
+		});
+
+		// the whole record is written at once, after the job, so nothing it logs can end up in the middle of it
+		std::ostringstream record;
+		const auto start_time = std::chrono::steady_clock::now();
+		record << "{\"job\":" << job_number << ",\"data_file\":" << quoted_for_json(job_config.data_file_name);
+		try {
+			const auto job_result = route_data_file(job_config, &route_stats);
+			record << ",\"status\":\"" << (job_result.routed ? "routed" : "unroutable") << '"';
+			if (job_result.track_width) {
+				record << ",\"track_width\":" << *job_result.track_width;
+			}
+		} catch (const std::exception& e) {
+			record << ",\"status\":\"error\",\"error\":" << quoted_for_json(e.what());
+			num_errored_jobs += 1;
+		}
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		record << ",\"seconds\":" << seconds << "}\n";
+
+		results << record.str() << std::flush;
+
+		job_number += 1;
+	}
+
+	write_route_stats(config, route_stats);
+
+	return num_errored_jobs == 0 ? 0 : 1;
+}
+
+/**
+ * Route every combination of the parameters in the sweep grid file, and write a CSV
+ * of how each run went. See flows::parse_sweep_grid for the format. When the CSV
+ * goes to stdout, the log goes to stderr.
+ */
+int sweep_main(const ProgramConfig& config) {
+
+	device::rr_graph_file::cacheDirectory() = config.rr_graph_cache_dir;
+
+	std::ifstream grid_file(config.sweep_grid_file_name);
+	if (!grid_file) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "couldn't open sweep grid " << config.sweep_grid_file_name;
+		});
+	}
+	const auto grid = flows::parse_sweep_grid(grid_file, config.nThreads);
+
+	std::ofstream results_file;
+	if (!config.sweep_results_file_name.empty()) {
+		results_file.open(config.sweep_results_file_name);
+		if (!results_file) {
+			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+				str << "couldn't open sweep results file " << config.sweep_results_file_name;
+			});
+		}
+	}
+	std::ostream& results = config.sweep_results_file_name.empty() ? std::cout : results_file;
+
+	return flows::run_sweep(grid, config.num_concurrent_sweep_runs, results) == 0 ? 0 : 1;
+}
+
+JobResult route_data_file(const ProgramConfig& config, algo::MazeRouteStats* route_stats) {
+
+	auto parse_result = input::parse_data_file(config.data_file_name, config.device_type_override);
+	auto visitor = util::compose_withbase<boost::static_visitor<JobResult>>(
+		[&](const std::string& err_str) -> JobResult {
 			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
 				str << err_str;
 			});
@@ -82,16 +275,77 @@ int program_main(const ProgramConfig& config) {
 				flows::fanout_test(device_info_to_use, config.nThreads);
 			}
 
-			if (config.route_as_is) {
-				flows::route_as_is(device_info_to_use, pr.pin_to_pin_netlist, pr.pin_order_in_input, config.nThreads);
+			if (!config.eco_file_name.empty()) {
+				const auto delta = read_eco_file(config.eco_file_name);
+				const auto routed = flows::route_eco(device_info_to_use, pr.pin_to_pin_netlist, pr.pin_order_in_input, delta, config.nThreads, route_stats);
+				return JobResult{routed, device_info_to_use.track_width};
+			} else if (config.route_as_is) {
+				const auto routed = flows::route_as_is(device_info_to_use, pr.pin_to_pin_netlist, pr.pin_order_in_input, config.nThreads, route_stats);
+				return JobResult{routed, device_info_to_use.track_width};
 			} else {
-				flows::track_width_exploration(device_info_to_use, pr.pin_to_pin_netlist, pr.pin_order_in_input, config.nThreads);
+				const auto track_width = flows::track_width_exploration(device_info_to_use, pr.pin_to_pin_netlist, pr.pin_order_in_input, config.nThreads, config.checkpoint_file_name, config.resume, route_stats);
+				return JobResult{static_cast<bool>(track_width), track_width};
 			}
 		}
 	);
-	apply_visitor(visitor, parse_result);
+	return apply_visitor(visitor, parse_result);
+}
 
-	return 0;
+algo::NetlistDelta read_eco_file(const std::string& eco_file_name) {
+	auto parse_result = input::parse_eco_file(eco_file_name);
+	auto visitor = util::compose_withbase<boost::static_visitor<algo::NetlistDelta>>(
+		[&](const std::string& err_str) -> algo::NetlistDelta {
+			util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+				str << eco_file_name << ": " << err_str;
+			});
+		},
+		[&](input::EcoParseResult& epr) {
+			return algo::NetlistDelta{std::move(epr.added), std::move(epr.removed)};
+		}
+	);
+	return apply_visitor(visitor, parse_result);
+}
+
+/**
+ * Write the search stats to the file asked for, if any - as CSV if its name ends in .csv, otherwise JSON
+ */
+void write_route_stats(const ProgramConfig& config, const algo::MazeRouteStats& route_stats) {
+	if (config.route_stats_file_name.empty()) {
+		return;
+	}
+
+	std::ofstream stats_file(config.route_stats_file_name);
+	if (!stats_file) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "couldn't open route stats file " << config.route_stats_file_name;
+		});
+	}
+
+	const std::string csv_extension = ".csv";
+	const auto& name = config.route_stats_file_name;
+	if (name.size() >= csv_extension.size() && name.compare(name.size() - csv_extension.size(), csv_extension.size(), csv_extension) == 0) {
+		algo::write_csv(stats_file, route_stats);
+	} else {
+		algo::write_json(stats_file, route_stats);
+	}
+
+	dout(DL::INFO) << "wrote stats of " << route_stats.num_searches << " searches to " << config.route_stats_file_name << '\n';
+}
+
+std::string quoted_for_json(const std::string& str) {
+	std::string result = "\"";
+	for (const auto& c : str) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			result += ' ';
+		} else {
+			result += c;
+		}
+	}
+	result += '"';
+	return result;
 }
 
 void do_optional_input_data_dump(const std::string& data_file_name, const input::ParseResult& pr) {
@@ -0,0 +1,196 @@
+#ifndef UTIL__BUMP_ALLOCATOR_H
+#define UTIL__BUMP_ALLOCATOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace util {
+
+/**
+ * Hands out contiguous arrays of T carved from large chunks. Nothing is
+ * freed individually - all memory is released when the allocator is destroyed.
+ *
+ * allocate() is lock-free, and may be called from many threads at once.
+ */
+template<typename T>
+class ConcurrentBumpAllocator {
+	struct Chunk {
+		Chunk(std::size_t capacity, Chunk* prev)
+			: data(new T[capacity])
+			, capacity(capacity)
+			, used(0)
+			, prev(prev)
+		{ }
+
+		Chunk(const Chunk&) = delete;
+		Chunk& operator=(const Chunk&) = delete;
+
+		std::unique_ptr<T[]> data;
+		const std::size_t capacity;
+		std::atomic<std::size_t> used;
+		Chunk* const prev;
+	};
+
+	const std::size_t chunk_size;
+	std::atomic<Chunk*> current;
+
+public:
+	explicit ConcurrentBumpAllocator(std::size_t chunk_size = 4096)
+		: chunk_size(chunk_size)
+		, current(nullptr)
+	{ }
+
+	ConcurrentBumpAllocator(const ConcurrentBumpAllocator&) = delete;
+	ConcurrentBumpAllocator& operator=(const ConcurrentBumpAllocator&) = delete;
+
+	~ConcurrentBumpAllocator() {
+		auto chunk = current.load();
+		while (chunk) {
+			const auto prev = chunk->prev;
+			delete chunk;
+			chunk = prev;
+		}
+	}
+
+	/**
+	 * Returns space for n (default constructed) T. Stays valid for the lifetime of this object.
+	 */
+	T* allocate(std::size_t n) {
+		while (true) {
+			auto chunk = current.load(std::memory_order_acquire);
+			if (chunk) {
+				const auto offset = chunk->used.fetch_add(n, std::memory_order_relaxed);
+				if (offset + n <= chunk->capacity) {
+					return chunk->data.get() + offset;
+				}
+			}
+
+			// the current chunk is full (or there isn't one), so try to install a new one.
+			// If some other thread beats us to it, then just go try theirs.
+			auto fresh_chunk = std::make_unique<Chunk>(std::max(n, chunk_size), chunk);
+			if (current.compare_exchange_strong(chunk, fresh_chunk.get(), std::memory_order_acq_rel)) {
+				fresh_chunk.release();
+			}
+		}
+	}
+};
+
+/**
+ * Single threaded memory for things that all go away at the same time - eg. the
+ * temporaries of a search. Allocating is a pointer bump, nothing is freed individually,
+ * and reset() makes all the memory available again in O(1), without giving it back.
+ * If it took more than one chunk to fit everything, they're replaced by one chunk
+ * that fits it all at the next reset(), so it soon settles on a single chunk.
+ */
+class MonotonicArena {
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+
+	std::vector<Chunk> chunks;
+	std::size_t current_chunk;
+	std::size_t used; // in the current chunk
+	std::size_t initial_chunk_size;
+
+public:
+	explicit MonotonicArena(std::size_t initial_chunk_size = 64*1024)
+		: chunks()
+		, current_chunk(0)
+		, used(0)
+		, initial_chunk_size(initial_chunk_size)
+	{ }
+
+	MonotonicArena(const MonotonicArena&) = delete;
+	MonotonicArena& operator=(const MonotonicArena&) = delete;
+	MonotonicArena(MonotonicArena&&) = default;
+	MonotonicArena& operator=(MonotonicArena&&) = default;
+
+	/**
+	 * Returns uninitialized space for `bytes`, that stays valid until the next reset()
+	 */
+	void* allocate(std::size_t bytes, std::size_t alignment) {
+		while (current_chunk < chunks.size()) {
+			const auto offset = (used + alignment - 1)/alignment*alignment;
+			if (offset + bytes <= chunks[current_chunk].size) {
+				used = offset + bytes;
+				return chunks[current_chunk].data.get() + offset;
+			}
+			current_chunk += 1;
+			used = 0;
+		}
+
+		const auto chunk_size = std::max({bytes + alignment, initial_chunk_size, capacity()});
+		chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[chunk_size]), chunk_size});
+		current_chunk = chunks.size() - 1;
+		used = 0;
+		return allocate(bytes, alignment);
+	}
+
+	void reset() {
+		if (chunks.size() > 1) {
+			const auto total_size = capacity();
+			chunks.clear();
+			chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[total_size]), total_size});
+		}
+		current_chunk = 0;
+		used = 0;
+	}
+
+	std::size_t capacity() const {
+		std::size_t result = 0;
+		for (const auto& chunk : chunks) {
+			result += chunk.size;
+		}
+		return result;
+	}
+
+	std::size_t heap_bytes() const { return capacity(); }
+};
+
+/**
+ * A standard allocator that takes from a MonotonicArena, or from the heap if it isn't given one
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator(MonotonicArena* arena = nullptr) : arena(arena) { }
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) { }
+
+	ArenaAllocator(const ArenaAllocator&) = default;
+	ArenaAllocator& operator=(const ArenaAllocator&) = default;
+
+	T* allocate(std::size_t n) {
+		if (arena) {
+			return static_cast<T*>(arena->allocate(n*sizeof(T), alignof(T)));
+		} else {
+			return std::allocator<T>().allocate(n);
+		}
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		if (!arena) {
+			std::allocator<T>().deallocate(p, n);
+		}
+	}
+
+	MonotonicArena* getArena() const { return arena; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& rhs) const { return arena == rhs.getArena(); }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& rhs) const { return arena != rhs.getArena(); }
+
+private:
+	MonotonicArena* arena;
+};
+
+} // end namespace util
+
+#endif // UTIL__BUMP_ALLOCATOR_H
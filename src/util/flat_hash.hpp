@@ -0,0 +1,322 @@
+#ifndef UTIL__FLAT_HASH_H
+#define UTIL__FLAT_HASH_H
+
+#include <util/id.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * The finaliser from splitmix64 - every bit of the input affects every bit of the output
+ */
+inline std::uint64_t mix_bits(std::uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111eb;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * A hash for integers and IDs that doesn't just pass the value through (like
+ * std::hash does), so that IDs with packed fields don't end up clustered
+ * together - which matters a lot for open addressing.
+ */
+template<class T, typename = void>
+struct MixingHash {
+	std::size_t operator()(const T& t) const {
+		return static_cast<std::size_t>(mix_bits(static_cast<std::uint64_t>(std::hash<T>()(t))));
+	}
+};
+
+template<class T>
+struct MixingHash<T, std::enable_if_t<std::is_base_of<IDBase, T>::value>> {
+	std::size_t operator()(const T& id) const {
+		return static_cast<std::size_t>(mix_bits(static_cast<std::uint64_t>(id.getValue())));
+	}
+};
+
+namespace detail {
+
+	struct FlatHashKeyIsValue {
+		template<typename T>
+		const T& operator()(const T& t) const { return t; }
+	};
+
+	struct FlatHashKeyIsFirst {
+		template<typename T>
+		const auto& operator()(const T& t) const { return t.first; }
+	};
+
+	/**
+	 * Linear probing over one array of slots, with no tombstones - erase shifts
+	 * later entries back instead. Slots keep their `occupied` flag next to the
+	 * value, so a probe usually touches just one cache line.
+	 *
+	 * Value must be default constructible and move assignable. Any insert or
+	 * erase invalidates all iterators and references.
+	 */
+	template<typename Key, typename Value, typename KeyOf, typename Hash, typename KeyEqual>
+	class FlatHashTable {
+		struct Slot {
+			bool occupied = false;
+			Value value = Value();
+		};
+
+		template<bool IS_CONST>
+		class Iterator {
+			using SlotPtr = std::conditional_t<IS_CONST, const Slot*, Slot*>;
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = Value;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::conditional_t<IS_CONST, const Value*, Value*>;
+			using reference = std::conditional_t<IS_CONST, const Value&, Value&>;
+
+			Iterator() : curr(nullptr), last(nullptr) { }
+			Iterator(SlotPtr curr, SlotPtr last) : curr(curr), last(last) { skip_empty(); }
+			template<bool OTHER_IS_CONST, typename = std::enable_if_t<IS_CONST && !OTHER_IS_CONST>>
+			Iterator(const Iterator<OTHER_IS_CONST>& other) : curr(other.curr), last(other.last) { }
+
+			reference operator*() const { return curr->value; }
+			pointer operator->() const { return &curr->value; }
+
+			Iterator& operator++() { ++curr; skip_empty(); return *this; }
+			Iterator operator++(int) { auto copy = *this; ++*this; return copy; }
+
+			bool operator==(const Iterator& rhs) const { return curr == rhs.curr; }
+			bool operator!=(const Iterator& rhs) const { return curr != rhs.curr; }
+
+		private:
+			template<bool> friend class Iterator;
+			friend class FlatHashTable;
+
+			void skip_empty() {
+				while (curr != last && !curr->occupied) {
+					++curr;
+				}
+			}
+
+			SlotPtr curr;
+			SlotPtr last;
+		};
+
+	public:
+		using key_type = Key;
+		using value_type = Value;
+		using size_type = std::size_t;
+		using iterator = Iterator<false>;
+		using const_iterator = Iterator<true>;
+
+		FlatHashTable() : slots(), num_elements(0), hasher(), key_equal() { }
+
+		iterator begin() { return { slots.data(), slots.data() + slots.size() }; }
+		iterator end()   { return { slots.data() + slots.size(), slots.data() + slots.size() }; }
+		const_iterator begin() const { return { slots.data(), slots.data() + slots.size() }; }
+		const_iterator end()   const { return { slots.data() + slots.size(), slots.data() + slots.size() }; }
+
+		size_type size() const { return num_elements; }
+		bool empty() const { return num_elements == 0; }
+
+		/**
+		 * The memory taken by the slots - not counting any owned by the values
+		 */
+		std::size_t heap_bytes() const { return slots.capacity()*sizeof(Slot); }
+
+		/**
+		 * Remove everything, but keep the memory
+		 */
+		void clear() {
+			if (num_elements == 0) {
+				return;
+			}
+			for (auto& slot : slots) {
+				if (slot.occupied) {
+					slot.occupied = false;
+					slot.value = Value();
+				}
+			}
+			num_elements = 0;
+		}
+
+		/**
+		 * Make room for n elements without any more allocation
+		 */
+		void reserve(size_type n) {
+			size_type capacity = slots.empty() ? 16 : slots.size();
+			while (!fits(n, capacity)) {
+				capacity *= 2;
+			}
+			if (capacity != slots.size()) {
+				rehash(capacity);
+			}
+		}
+
+		iterator find(const Key& key) {
+			const auto index = find_index(key);
+			return index == NOT_FOUND ? end() : iterator_at(index);
+		}
+
+		const_iterator find(const Key& key) const {
+			const auto index = find_index(key);
+			return index == NOT_FOUND ? end() : const_iterator(slots.data() + index, slots.data() + slots.size());
+		}
+
+		size_type count(const Key& key) const { return find_index(key) == NOT_FOUND ? 0 : 1; }
+
+		/**
+		 * Returns where value's key is, and if value was put there
+		 */
+		std::pair<iterator, bool> insert(Value value) {
+			reserve(num_elements + 1);
+			auto index = home_of(KeyOf()(value));
+			while (slots[index].occupied) {
+				if (key_equal(KeyOf()(slots[index].value), KeyOf()(value))) {
+					return {iterator_at(index), false};
+				}
+				index = next(index);
+			}
+			slots[index].occupied = true;
+			slots[index].value = std::move(value);
+			num_elements += 1;
+			return {iterator_at(index), true};
+		}
+
+		size_type erase(const Key& key) {
+			auto hole = find_index(key);
+			if (hole == NOT_FOUND) {
+				return 0;
+			}
+
+			// pull back anything after the hole that would no longer be found
+			for (auto index = next(hole); slots[index].occupied; index = next(index)) {
+				const auto home = home_of(KeyOf()(slots[index].value));
+				const bool home_is_between_hole_and_here = hole <= index
+					? (hole < home && home <= index)
+					: (hole < home || home <= index);
+				if (!home_is_between_hole_and_here) {
+					slots[hole].value = std::move(slots[index].value);
+					hole = index;
+				}
+			}
+
+			slots[hole].occupied = false;
+			slots[hole].value = Value();
+			num_elements -= 1;
+			return 1;
+		}
+
+	protected:
+		static const size_type NOT_FOUND = static_cast<size_type>(-1);
+
+		size_type find_index(const Key& key) const {
+			if (num_elements == 0) {
+				return NOT_FOUND;
+			}
+			for (auto index = home_of(key); slots[index].occupied; index = next(index)) {
+				if (key_equal(KeyOf()(slots[index].value), key)) {
+					return index;
+				}
+			}
+			return NOT_FOUND;
+		}
+
+		iterator iterator_at(size_type index) { return { slots.data() + index, slots.data() + slots.size() }; }
+
+	private:
+		static bool fits(size_type n, size_type capacity) { return n*4 <= capacity*3; }
+
+		size_type home_of(const Key& key) const { return hasher(key) & (slots.size() - 1); }
+		size_type next(size_type index) const { return (index + 1) & (slots.size() - 1); }
+
+		void rehash(size_type capacity) {
+			auto old_slots = std::move(slots);
+			slots = std::vector<Slot>(capacity);
+			num_elements = 0;
+			for (auto& slot : old_slots) {
+				if (slot.occupied) {
+					auto index = home_of(KeyOf()(slot.value));
+					while (slots[index].occupied) {
+						index = next(index);
+					}
+					slots[index].occupied = true;
+					slots[index].value = std::move(slot.value);
+					num_elements += 1;
+				}
+			}
+		}
+
+		std::vector<Slot> slots;
+		size_type num_elements;
+		Hash hasher;
+		KeyEqual key_equal;
+	};
+
+	template<typename Key, typename Value, typename KeyOf, typename Hash, typename KeyEqual>
+	const typename FlatHashTable<Key, Value, KeyOf, Hash, KeyEqual>::size_type FlatHashTable<Key, Value, KeyOf, Hash, KeyEqual>::NOT_FOUND;
+
+} // end namespace detail
+
+/**
+ * An open-addressing replacement for std::unordered_set, for small keys like IDs.
+ * Iteration order is unspecified, and any insert or erase invalidates iterators.
+ */
+template<typename Key, typename Hash = MixingHash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashSet : public detail::FlatHashTable<Key, Key, detail::FlatHashKeyIsValue, Hash, KeyEqual> {
+public:
+	template<typename... Args>
+	auto emplace(Args&&... args) {
+		return this->insert(Key(std::forward<Args>(args)...));
+	}
+};
+
+/**
+ * An open-addressing replacement for std::unordered_map, for small keys like IDs.
+ * Elements are std::pair<Key, T> (the key isn't const, but must not be modified).
+ * Iteration order is unspecified, and any insert or erase invalidates iterators.
+ */
+template<typename Key, typename T, typename Hash = MixingHash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap : public detail::FlatHashTable<Key, std::pair<Key, T>, detail::FlatHashKeyIsFirst, Hash, KeyEqual> {
+	using Base = detail::FlatHashTable<Key, std::pair<Key, T>, detail::FlatHashKeyIsFirst, Hash, KeyEqual>;
+public:
+	using mapped_type = T;
+
+	template<typename... Args>
+	auto emplace(const Key& key, Args&&... args) {
+		const auto index = this->find_index(key);
+		if (index != Base::NOT_FOUND) {
+			return std::make_pair(this->iterator_at(index), false);
+		}
+		return this->insert(std::pair<Key, T>(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)));
+	}
+
+	T& operator[](const Key& key) {
+		return emplace(key).first->second;
+	}
+
+	T& at(const Key& key) {
+		return const_cast<T&>(static_cast<const FlatHashMap&>(*this).at(key));
+	}
+
+	const T& at(const Key& key) const {
+		const auto index = this->find_index(key);
+		if (index == Base::NOT_FOUND) {
+			throw std::out_of_range("key not in FlatHashMap");
+		}
+		return this->find(key)->second;
+	}
+};
+
+} // end namespace util
+
+#endif // UTIL__FLAT_HASH_H
@@ -0,0 +1,195 @@
+#ifndef UTIL__FROZEN_NETLIST_H
+#define UTIL__FROZEN_NETLIST_H
+
+#include <util/flat_hash.hpp>
+#include <util/netlist.hpp>
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <boost/range/iterator_range.hpp>
+
+namespace util {
+
+namespace detail {
+	/**
+	 * A stack that keeps its first N elements inline, and only allocates if it gets deeper
+	 */
+	template<typename T, std::size_t N>
+	class SmallStack {
+	public:
+		bool empty() const { return count == 0; }
+
+		void push(T t) {
+			if (count < N) {
+				inline_elements[count] = std::move(t);
+			} else {
+				overflow.push_back(std::move(t));
+			}
+			count += 1;
+		}
+
+		T pop() {
+			count -= 1;
+			if (count < N) {
+				return std::move(inline_elements[count]);
+			} else {
+				auto t = std::move(overflow.back());
+				overflow.pop_back();
+				return t;
+			}
+		}
+
+	private:
+		std::array<T, N> inline_elements = std::array<T, N>();
+		std::vector<T> overflow = {};
+		std::size_t count = 0;
+	};
+}
+
+/**
+ * A read-only copy of a forest Netlist in compressed sparse row form: the fanout of
+ * each node is a contiguous array, and traversals don't look anything up by ID or
+ * allocate (unless a tree is unusually bushy). Iteration orders match the Netlist
+ * it was made from.
+ *
+ * Build with a Netlist, then freeze it when it's going to be read a lot.
+ */
+template<typename NODE_ID>
+class FrozenNetlist {
+	using Index = std::size_t;
+	static const Index NO_PARENT = static_cast<Index>(-1);
+public:
+	FrozenNetlist()
+		: index_of()
+		, nodes()
+		, parents()
+		, fanout_offsets(1, 0)
+		, fanout_ids()
+		, fanout_indices()
+		, m_roots()
+	{ }
+
+	explicit FrozenNetlist(const Netlist<NODE_ID, true>& netlist)
+		: FrozenNetlist()
+	{
+		for (const auto& id : netlist.all_ids()) {
+			index_of.emplace(id, nodes.size());
+			nodes.push_back(id);
+		}
+		parents.assign(nodes.size(), NO_PARENT);
+
+		for (Index inode = 0; inode < nodes.size(); ++inode) {
+			for (const auto& sink : netlist.fanout(nodes[inode])) {
+				const auto isink = index_of.at(sink);
+				fanout_ids.push_back(sink);
+				fanout_indices.push_back(isink);
+				parents[isink] = inode;
+			}
+			fanout_offsets.push_back(fanout_ids.size());
+		}
+
+		for (const auto& root : netlist.roots()) {
+			m_roots.push_back(root);
+		}
+	}
+
+	bool empty() const { return nodes.empty(); }
+	std::size_t size() const { return nodes.size(); }
+
+	bool contains(const NODE_ID& id) const { return index_of.count(id) != 0; }
+
+	bool isRoot(const NODE_ID& id) const {
+		const auto found = index_of.find(id);
+		return found != index_of.end() && parents[found->second] == NO_PARENT;
+	}
+
+	auto roots() const {
+		return boost::make_iterator_range(m_roots.data(), m_roots.data() + m_roots.size());
+	}
+
+	auto all_ids() const {
+		return boost::make_iterator_range(nodes.data(), nodes.data() + nodes.size());
+	}
+
+	boost::iterator_range<const NODE_ID*> fanout(const NODE_ID& source) const {
+		const auto found = index_of.find(source);
+		if (found == index_of.end()) {
+			return { };
+		} else {
+			return fanoutOfIndex(found->second);
+		}
+	}
+
+	/**
+	 * Calls visitor(node, state) on start and everything below it, parents before
+	 * children (depth first), where state is what visitor returned for the parent.
+	 */
+	template<typename VisitorState, typename Visitor>
+	void for_all_descendants(const NODE_ID& start, VisitorState&& initial_state, Visitor&& visitor) const {
+		using State = std::decay_t<VisitorState>;
+
+		const auto found = index_of.find(start);
+		if (found == index_of.end()) {
+			visitor(start, initial_state);
+			return;
+		}
+
+		detail::SmallStack<std::pair<Index, State>, 32> to_visit;
+		to_visit.push({found->second, std::forward<VisitorState>(initial_state)});
+
+		while (!to_visit.empty()) {
+			const auto curr_and_state = to_visit.pop();
+			const auto& curr = curr_and_state.first;
+
+			const State new_state = visitor(nodes[curr], curr_and_state.second);
+
+			// backwards, so that the first fanout is visited first
+			for (auto ifanout = fanout_offsets[curr + 1]; ifanout != fanout_offsets[curr]; --ifanout) {
+				to_visit.push({fanout_indices[ifanout - 1], new_state});
+			}
+		}
+	}
+
+	template<typename VisitorState, typename Visitor>
+	void for_all_descendant_edges(const NODE_ID& start, VisitorState&& initial_state, Visitor&& visitor) const {
+		struct State {
+			NODE_ID parent;
+			std::decay_t<VisitorState> visitor_state;
+		};
+		struct Params {
+			NODE_ID curr;
+			NODE_ID parent;
+		};
+
+		for_all_descendants(start, State{start, initial_state}, [&](const NODE_ID& node, const State& state) {
+			if (node != start) {
+				return State{node, visitor(Params{node, state.parent}, state.visitor_state)};
+			} else {
+				return State{node, state.visitor_state};
+			}
+		});
+	}
+
+private:
+	boost::iterator_range<const NODE_ID*> fanoutOfIndex(Index inode) const {
+		return { fanout_ids.data() + fanout_offsets[inode], fanout_ids.data() + fanout_offsets[inode + 1] };
+	}
+
+	FlatHashMap<NODE_ID, Index> index_of;
+	std::vector<NODE_ID> nodes;
+	std::vector<Index> parents; // NO_PARENT for roots
+	std::vector<Index> fanout_offsets; // the fanout of node i is [fanout_offsets[i], fanout_offsets[i+1])
+	std::vector<NODE_ID> fanout_ids;
+	std::vector<Index> fanout_indices;
+	std::vector<NODE_ID> m_roots;
+};
+
+template<typename NODE_ID>
+const typename FrozenNetlist<NODE_ID>::Index FrozenNetlist<NODE_ID>::NO_PARENT;
+
+} // end namespace util
+
+#endif // UTIL__FROZEN_NETLIST_H
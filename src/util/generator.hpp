@@ -5,6 +5,11 @@
 #include <functional>
 #include <util/tuple_utils.hpp>
 
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
 namespace util {
 
 namespace detail {
@@ -1,19 +1,44 @@
 #ifndef UTIL__GRAPH_ALGORITHMS_H
 #define UTIL__GRAPH_ALGORITHMS_H
 
-#include <list>
+#include <util/bump_allocator.hpp>
+#include <util/flat_hash.hpp>
+#include <util/memory_usage.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <thread>
-#include <unordered_map>
-#include <unordered_set>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/range/iterator_range.hpp>
 
 namespace util {
 
+/**
+ * What the threads of one wave of wavedBreadthFirstVisit did, added up
+ */
+struct WaveCounts {
+	std::size_t num_skipped_explores = 0;
+	std::size_t num_fanouts = 0; // put in the next wave
+	std::size_t num_skipped_fanouts = 0; // already reached, or ignored
+};
+
 template<typename VertexID>
 class DefaultGraphVisitor {
 public:
+	/**
+	 * Called once per wave, from the calling thread, with what onSkippedExplore, onFanout
+	 * and onSkippedFanout were called for - so visitors can count those without the wave's
+	 * threads sharing a counter.
+	 */
+	void onWaveCounts(const WaveCounts&) { }
+
 	template<typename VertexCollection>
 	void onWaveStart(const VertexCollection&) { }
 
@@ -46,6 +71,72 @@ namespace detail {
 		bool operator()(T&&...) { return false; }
 	};
 
+	template<int N> struct Preference : Preference<N-1> { };
+	template<> struct Preference<0> { };
+
+	/**
+	 * Prefer a graph's contiguous fanout_span(id) if it has one, as iterating
+	 * that is much cheaper than going through fanout(id)'s generator.
+	 */
+	template<typename FanoutGen, typename ID>
+	auto fanout_of(const FanoutGen& fanout_gen, const ID& id, Preference<1>) -> decltype(fanout_gen.fanout_span(id)) {
+		return fanout_gen.fanout_span(id);
+	}
+
+	template<typename FanoutGen, typename ID>
+	auto fanout_of(const FanoutGen& fanout_gen, const ID& id, Preference<0>) -> decltype(fanout_gen.fanout(id)) {
+		return fanout_gen.fanout(id);
+	}
+
+	/**
+	 * Graphs whose ids can name things that aren't vertices (a device's pins off its
+	 * edge, say) have contains_vertex(id). Anything else is assumed to be a vertex.
+	 */
+	template<typename Graph, typename ID>
+	auto contains_vertex(const Graph& graph, const ID& id, Preference<1>) -> decltype(bool(graph.contains_vertex(id))) {
+		return graph.contains_vertex(id);
+	}
+
+	template<typename Graph, typename ID>
+	bool contains_vertex(const Graph&, const ID&, Preference<0>) {
+		return true;
+	}
+
+	/**
+	 * Calls f(id, fanouts) for each of ids, in order. Graphs with a fanout_span are
+	 * read directly, failing that, graphs that can compute many fanouts at once
+	 * (fanout_batch) are asked for all of them together, using the scratch buffers.
+	 */
+	template<typename FanoutGen, typename IDs, typename Buffer, typename Func>
+	auto for_each_fanout(const FanoutGen& fanout_gen, const IDs& ids, Buffer&, std::vector<std::size_t>&, Func&& f, Preference<2>)
+		-> decltype(fanout_gen.fanout_span(ids.front()), void())
+	{
+		for (const auto& id : ids) {
+			f(id, fanout_gen.fanout_span(id));
+		}
+	}
+
+	template<typename FanoutGen, typename IDs, typename Buffer, typename Func>
+	auto for_each_fanout(const FanoutGen& fanout_gen, const IDs& ids, Buffer& fanouts, std::vector<std::size_t>& ends, Func&& f, Preference<1>)
+		-> decltype(fanout_gen.fanout_batch(ids.data(), ids.size(), fanouts, ends), void())
+	{
+		fanouts.clear();
+		ends.clear();
+		fanout_gen.fanout_batch(ids.data(), ids.size(), fanouts, ends);
+		std::size_t begin_index = 0;
+		for (std::size_t i = 0; i < ids.size(); ++i) {
+			f(ids[i], boost::make_iterator_range(fanouts.data() + begin_index, fanouts.data() + ends[i]));
+			begin_index = ends[i];
+		}
+	}
+
+	template<typename FanoutGen, typename IDs, typename Buffer, typename Func>
+	void for_each_fanout(const FanoutGen& fanout_gen, const IDs& ids, Buffer&, std::vector<std::size_t>&, Func&& f, Preference<0>) {
+		for (const auto& id : ids) {
+			f(id, fanout_gen.fanout(id));
+		}
+	}
+
 	template<template <typename...> class Map, typename... InitialParams>
 	struct BasicMapMaker {
 		template<typename... RestParams>
@@ -53,11 +144,373 @@ namespace detail {
 			return Map<InitialParams..., RestParams...>();
 		}
 	};
+
+	/**
+	 * A FIFO queue in one power-of-two sized array, that grows when full
+	 */
+	template<typename T>
+	class RingBuffer {
+	public:
+		bool empty() const { return count == 0; }
+		const T& front() const { return slots[head]; }
+
+		void push_back(const T& t) {
+			if (count == slots.size()) {
+				grow();
+			}
+			slots[(head + count) & (slots.size() - 1)] = t;
+			count += 1;
+		}
+
+		void pop_front() {
+			head = (head + 1) & (slots.size() - 1);
+			count -= 1;
+		}
+
+	private:
+		void grow() {
+			std::vector<T> new_slots(std::max<std::size_t>(16, slots.size()*2));
+			for (std::size_t i = 0; i < count; ++i) {
+				new_slots[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+			}
+			slots = std::move(new_slots);
+			head = 0;
+		}
+
+		std::vector<T> slots = {};
+		std::size_t head = 0;
+		std::size_t count = 0;
+	};
+
+	/**
+	 * A set of vertices as a bitset, for graphs that advertise a dense index:
+	 * num_vertices(), and index_of(id) in [0, num_vertices()) for every vertex.
+	 */
+	template<typename Graph>
+	class DenseVertexSet {
+	public:
+		explicit DenseVertexSet(const Graph& graph)
+			: graph(&graph)
+			, num_vertices(static_cast<std::size_t>(graph.num_vertices()))
+			, words((num_vertices + 63)/64, 0)
+		{ }
+
+		DenseVertexSet(const DenseVertexSet&) = default;
+		DenseVertexSet& operator=(const DenseVertexSet&) = default;
+		DenseVertexSet(DenseVertexSet&&) = default;
+		DenseVertexSet& operator=(DenseVertexSet&&) = default;
+
+		template<typename ID>
+		std::size_t index(const ID& id) const {
+			const auto i = static_cast<std::size_t>(graph->index_of(id));
+			if (i >= num_vertices) {
+				throw std::out_of_range("graph gave a vertex an index past its num_vertices()");
+			}
+			return i;
+		}
+
+		bool containsIndex(std::size_t i) const {
+			return ((words[i/64] >> (i%64)) & 1) != 0;
+		}
+
+		/**
+		 * Returns true if i wasn't already in the set
+		 */
+		bool insertIndex(std::size_t i) {
+			const auto bit = std::uint64_t(1) << (i%64);
+			const bool was_there = (words[i/64] & bit) != 0;
+			words[i/64] |= bit;
+			return !was_there;
+		}
+
+		template<typename ID>
+		bool contains(const ID& id) const { return containsIndex(index(id)); }
+
+		template<typename ID>
+		bool insert(const ID& id) { return insertIndex(index(id)); }
+
+		std::size_t numVertices() const { return num_vertices; }
+		std::size_t heap_bytes() const { return words.capacity()*sizeof(std::uint64_t); }
+
+	private:
+		const Graph* graph;
+		std::size_t num_vertices;
+		std::vector<std::uint64_t> words;
+	};
+
+	template<typename ID>
+	class HashedVertexSet {
+	public:
+		bool contains(const ID& id) const { return set.count(id) != 0; }
+		bool insert(const ID& id) { return set.insert(id).second; }
+	private:
+		FlatHashSet<ID> set = {};
+	};
+
+	template<typename ID, typename Graph>
+	auto make_vertex_set(const Graph& graph, Preference<1>)
+		-> decltype(graph.num_vertices(), graph.index_of(std::declval<const ID&>()), DenseVertexSet<Graph>(graph))
+	{
+		return DenseVertexSet<Graph>(graph);
+	}
+
+	template<typename ID, typename Graph>
+	HashedVertexSet<ID> make_vertex_set(const Graph&, Preference<0>) {
+		return {};
+	}
+
+	template<typename ID>
+	struct VisitTreeParent {
+		ID parent = ID();
+		bool has_parent = false;
+	};
+
+	/**
+	 * The vertices a search reached, and the vertex each was first reached from,
+	 * kept in a map from ID (made by GraphAlgo's MapGen)
+	 */
+	template<typename ID, typename Map>
+	class MapVisitTree {
+	public:
+		explicit MapVisitTree(Map map) : parents(std::move(map)) { }
+
+		bool reached(const ID& id) const { return parents.find(id) != parents.end(); }
+
+		bool addRoot(const ID& id) {
+			return parents.emplace(id, VisitTreeParent<ID>()).second;
+		}
+
+		bool add(const ID& id, const ID& parent) {
+			return parents.emplace(id, VisitTreeParent<ID>{parent, true}).second;
+		}
+
+		/**
+		 * none for roots and vertices that weren't reached
+		 */
+		boost::optional<ID> parent(const ID& id) const {
+			const auto found = parents.find(id);
+			if (found == parents.end() || !found->second.has_parent) {
+				return boost::none;
+			} else {
+				return found->second.parent;
+			}
+		}
+
+		std::size_t heap_bytes() const { return util::heap_bytes(parents); }
+
+	private:
+		Map parents;
+	};
+
+	/**
+	 * The per-vertex arrays of a DenseVisitTree, kept from one search to the next.
+	 * A vertex was reached by the current search if its stamp is the current generation,
+	 * so starting a search is just moving to the next generation - nothing is cleared,
+	 * except when the graph's size changes, or (rarely) the generation wraps around.
+	 */
+	struct DenseVisitArrays {
+		std::vector<std::uint32_t> stamp_of = {};
+		std::vector<std::size_t> position_of = {}; // only meaningful where stamp_of is current
+		std::uint32_t generation = 0;
+
+		void startSearch(std::size_t num_vertices) {
+			if (stamp_of.size() != num_vertices) {
+				stamp_of.assign(num_vertices, 0);
+				position_of.resize(num_vertices);
+				generation = 0;
+			}
+			generation += 1;
+			if (generation == 0) {
+				std::fill(begin(stamp_of), end(stamp_of), 0);
+				generation = 1;
+			}
+		}
+
+		std::size_t heap_bytes() const { return util::heap_bytes(stamp_of) + util::heap_bytes(position_of); }
+	};
+
+	/**
+	 * MapVisitTree for graphs with a dense index. Each reached vertex gets a position
+	 * in the order they were reached, which is recorded in `arrays` (see DenseVisitArrays),
+	 * so setting up a search doesn't cost anything per vertex of the graph.
+	 * Without `arrays`, the tree has its own (and so costs time in proportion to the graph).
+	 * The list of reached vertices is taken from `arena` if one is given.
+	 * Only valid until the next search that uses the same arrays or arena.
+	 */
+	template<typename ID, typename Graph>
+	class DenseVisitTree {
+	public:
+		explicit DenseVisitTree(const Graph& graph, DenseVisitArrays* given_arrays = nullptr, MonotonicArena* arena = nullptr)
+			: graph(&graph)
+			, owned_arrays(given_arrays ? nullptr : new DenseVisitArrays())
+			, arrays(given_arrays ? given_arrays : owned_arrays.get())
+			, num_vertices(static_cast<std::size_t>(graph.num_vertices()))
+			, generation()
+			, vertices(ArenaAllocator<ID>(arena))
+			, parent_positions(ArenaAllocator<std::size_t>(arena))
+		{
+			arrays->startSearch(num_vertices);
+			generation = arrays->generation;
+		}
+
+		DenseVisitTree(const DenseVisitTree&) = delete;
+		DenseVisitTree& operator=(const DenseVisitTree&) = delete;
+		DenseVisitTree(DenseVisitTree&&) = default;
+		DenseVisitTree& operator=(DenseVisitTree&&) = default;
+
+		bool reached(const ID& id) const { return reachedIndex(index(id)); }
+
+		bool addRoot(const ID& id) {
+			return addWithParentPosition(id, NO_PARENT);
+		}
+
+		bool add(const ID& id, const ID& parent) {
+			return addWithParentPosition(id, arrays->position_of[index(parent)]);
+		}
+
+		boost::optional<ID> parent(const ID& id) const {
+			const auto i = index(id);
+			if (!reachedIndex(i)) {
+				return boost::none;
+			}
+			const auto parent_position = parent_positions[arrays->position_of[i]];
+			if (parent_position == NO_PARENT) {
+				return boost::none;
+			} else {
+				return vertices[parent_position];
+			}
+		}
+
+		std::size_t heap_bytes() const {
+			return arrays->heap_bytes()
+				+ util::heap_bytes(vertices)
+				+ util::heap_bytes(parent_positions);
+		}
+
+	private:
+		static const std::size_t NO_PARENT = static_cast<std::size_t>(-1);
+
+		std::size_t index(const ID& id) const {
+			const auto i = static_cast<std::size_t>(graph->index_of(id));
+			if (i >= num_vertices) {
+				throw std::out_of_range("graph gave a vertex an index past its num_vertices()");
+			}
+			return i;
+		}
+
+		bool reachedIndex(std::size_t i) const { return arrays->stamp_of[i] == generation; }
+
+		bool addWithParentPosition(const ID& id, std::size_t parent_position) {
+			const auto i = index(id);
+			if (reachedIndex(i)) {
+				return false;
+			}
+			arrays->stamp_of[i] = generation;
+			arrays->position_of[i] = vertices.size();
+			vertices.push_back(id);
+			parent_positions.push_back(parent_position);
+			return true;
+		}
+
+		const Graph* graph;
+		std::unique_ptr<DenseVisitArrays> owned_arrays;
+		DenseVisitArrays* arrays;
+		std::size_t num_vertices;
+		std::uint32_t generation;
+		std::vector<ID, ArenaAllocator<ID>> vertices;
+		std::vector<std::size_t, ArenaAllocator<std::size_t>> parent_positions;
+	};
+
+	template<typename ID, typename Graph>
+	const std::size_t DenseVisitTree<ID, Graph>::NO_PARENT;
+
+	template<typename ID, typename Graph, typename Map>
+	auto make_visit_tree(const Graph& graph, Map&&, DenseVisitArrays* arrays, MonotonicArena* arena, Preference<1>)
+		-> decltype(graph.num_vertices(), graph.index_of(std::declval<const ID&>()), DenseVisitTree<ID, Graph>(graph, arrays, arena))
+	{
+		return DenseVisitTree<ID, Graph>(graph, arrays, arena);
+	}
+
+	template<typename ID, typename Graph, typename Map>
+	auto make_visit_tree(const Graph&, Map&& map, DenseVisitArrays*, MonotonicArena*, Preference<0>) {
+		return MapVisitTree<ID, std::decay_t<Map>>(std::forward<Map>(map));
+	}
+
+	template<typename ID>
+	struct WaveExploration {
+		ID parent;
+		ID fanout;
+	};
+
+	/**
+	 * What one thread of wavedBreadthFirstVisit works in
+	 */
+	template<typename ID>
+	struct WaveBuffers {
+		std::vector<WaveExploration<ID>> next_wave = {};
+		std::vector<ID> to_explore = {};
+		std::vector<ID> fanouts = {};
+		std::vector<std::size_t> fanout_ends = {};
+		WaveCounts counts = {};
+		void clear() {
+			next_wave.clear();
+		}
+		std::size_t heap_bytes() const {
+			return util::heap_bytes(next_wave) + util::heap_bytes(to_explore) + util::heap_bytes(fanouts) + util::heap_bytes(fanout_ends);
+		}
+	};
+}
+
+template<typename ID, typename MapGen>
+class GraphAlgo;
+
+/**
+ * Memory that wavedBreadthFirstVisit can keep from one search to the next, instead of
+ * allocating it each time: the wave buffers, the visit tree's per-vertex arrays, and an
+ * arena for the rest of the visit tree that is reset at the start of each search. With it,
+ * setting up a search costs nothing per vertex of the graph (after the first). So, the tree returned by a search is only valid until the
+ * next search given the same workspace. Only one search may use a workspace at a time.
+ */
+template<typename ID>
+class SearchWorkspace {
+public:
+	SearchWorkspace() : arena(), visit_arrays(), curr_wave(), wave_buffers() { }
+
+	SearchWorkspace(const SearchWorkspace&) = delete;
+	SearchWorkspace& operator=(const SearchWorkspace&) = delete;
+	SearchWorkspace(SearchWorkspace&&) = default;
+	SearchWorkspace& operator=(SearchWorkspace&&) = default;
+
+	std::size_t heap_bytes() const {
+		return arena.heap_bytes() + visit_arrays.heap_bytes() + util::heap_bytes(curr_wave) + util::heap_bytes(wave_buffers);
+	}
+
+private:
+	template<typename, typename> friend class GraphAlgo;
+
+	MonotonicArena arena;
+	detail::DenseVisitArrays visit_arrays;
+	std::vector<ID> curr_wave;
+	std::vector<detail::WaveBuffers<ID>> wave_buffers;
+};
+
+/**
+ * The fanout of id in graph, read the cheapest way graph offers (see detail::fanout_of).
+ */
+template<typename Graph, typename ID>
+auto fanout_of(const Graph& graph, const ID& id) -> decltype(detail::fanout_of(graph, id, detail::Preference<1>())) {
+	return detail::fanout_of(graph, id, detail::Preference<1>());
 }
 
+/**
+ * Graph traversals over anything with a fanout(id) (see fanout_of).
+ * Graphs that also have num_vertices() and index_of(id), a numbering of their
+ * vertices from 0, get traversal state in flat arrays and bitsets instead of
+ * maps keyed by ID (and MapGen isn't used).
+ */
 template<
 	typename ID,
-	typename MapGen = detail::BasicMapMaker<std::unordered_map, ID> >
+	typename MapGen = detail::BasicMapMaker<util::FlatHashMap, ID> >
 class GraphAlgo {
 private:
 	int NTHREADS = 1;
@@ -103,31 +556,25 @@ public:
 
 template<typename FanoutGen, typename InitialList, typename Visitor, typename ShouldIgnore = detail::AlwaysFalse>
 void breadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_list, Visitor&& visitor, ShouldIgnore&& should_ignore = ShouldIgnore()) const {
-	struct VertexData {
-		bool put_in_queue = false;
-		bool expanded = false;
-	};
+	detail::RingBuffer<ID> to_visit;
+	auto put_in_queue = detail::make_vertex_set<ID>(fanout_gen, detail::Preference<1>());
 
-	std::list<ID> to_visit;
 	for (const auto& vertex : initial_list) {
-		to_visit.push_back(vertex);
+		if (put_in_queue.insert(vertex)) {
+			to_visit.push_back(vertex);
+		}
 	}
 
-	std::unordered_map<ID, VertexData> data;
-
 	while (!to_visit.empty()) {
 		const auto explore_curr = to_visit.front();
 		to_visit.pop_front();
 
-		if (data[explore_curr].expanded) {
-			continue;
-		} else if (should_ignore(explore_curr)) {
+		if (should_ignore(explore_curr)) {
 			continue;
 		}
 
-		for (const auto& fanout : fanout_gen.fanout(explore_curr)) {
-			if (!data[fanout].put_in_queue && !data[fanout].expanded && !should_ignore(fanout)) {
-				data[fanout].put_in_queue = true;
+		for (const auto& fanout : util::fanout_of(fanout_gen, explore_curr)) {
+			if (!should_ignore(fanout) && put_in_queue.insert(fanout)) {
 				to_visit.push_back(fanout);
 			}
 		}
@@ -137,38 +584,40 @@ void breadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_list,
 
 }
 
+/**
+ * Returns what was reached: an object with reached(id), and parent(id) - the
+ * vertex that id was first reached from (none for those in initial_list).
+ * If given a workspace, the search works in (and the result lives in) its memory.
+ * Without one, a graph with a dense index costs time in proportion to its size per search.
+ */
 template<typename FanoutGen, typename InitialList, typename IsTarget, typename Visitor, typename ShouldIgnore = detail::AlwaysFalse>
-auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_list, IsTarget&& isTarget, Visitor&& visitor, ShouldIgnore&& should_ignore = ShouldIgnore()) const {
-	struct VertexData {
-		std::vector<ID> fanin = {};
-	};
+auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_list, IsTarget&& isTarget, Visitor&& visitor, ShouldIgnore&& should_ignore = ShouldIgnore(), SearchWorkspace<ID>* workspace = nullptr) const {
+	SearchWorkspace<ID> own_workspace;
+	auto& buffers = workspace ? *workspace : own_workspace;
+	MonotonicArena* arena = nullptr;
+	detail::DenseVisitArrays* visit_arrays = nullptr;
+	if (workspace) {
+		workspace->arena.reset();
+		arena = &workspace->arena;
+		visit_arrays = &workspace->visit_arrays;
+	}
 
-	auto data = makeVertexMap<VertexData>();
+	auto data = detail::make_visit_tree<ID>(fanout_gen, makeVertexMap<detail::VisitTreeParent<ID>>(), visit_arrays, arena, detail::Preference<1>());
 
-	struct ExploreData {
-		ID parent;
-		ID fanout;
-	};
+	auto& curr_wave = buffers.curr_wave;
+	curr_wave.clear();
 
-	std::vector<ID> curr_wave = {};
-	struct WaveData {
-		std::vector<ExploreData> next_wave = {};
-		void clear() {
-			next_wave.clear();
-		}
-	};
-
-	std::vector<WaveData> waveData(NTHREADS);
+	auto& waveData = buffers.wave_buffers;
+	waveData.resize(static_cast<std::size_t>(NTHREADS));
+	for (auto& waveDatum : waveData) {
+		waveDatum.clear();
+	}
 
 	for (const auto& vertex : initial_list) {
 		curr_wave.push_back(vertex);
-		data[vertex];
+		data.addRoot(vertex);
 	}
 
-	// the follewing are cleared and reused
-	std::vector<ExploreData> explorations_to_new_nodes;
-	std::unordered_set<ID> in_next_wave;
-
 	while(true) {
 		visitor.onWaveStart(curr_wave);
 		visitor.onExploreStart();
@@ -181,24 +630,36 @@ auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_l
 				std::next(begin(curr_wave), std::min(curr_wave.size(), my_curr_wave_begin_index)),
 				std::next(begin(curr_wave), std::min(curr_wave.size(), my_curr_wave_end_index))
 			);
-			auto& my_next_wave = waveData[ithread].next_wave;
+			auto& my_wave_data = waveData[ithread];
+			auto& my_next_wave = my_wave_data.next_wave;
 
+			WaveCounts my_counts; // written to my_wave_data at the end, so threads don't share cache lines meanwhile
+
+			my_wave_data.to_explore.clear();
 			for (const auto& id : my_curr_wave) {
 				if (should_ignore(id)) {
 					visitor.onSkippedExplore(id);
-					continue;
+					my_counts.num_skipped_explores += 1;
 				} else {
-					visitor.onExplore(id);
-					for (const auto& fanout : fanout_gen.fanout(id)) {
-						if (data.find(fanout) == end(data) && !should_ignore(fanout)) {
-							my_next_wave.emplace_back(ExploreData{id, fanout});
-							visitor.onFanout(id, fanout);
-						} else {
-							visitor.onSkippedFanout(id, fanout);
-						}
-					}
+					my_wave_data.to_explore.push_back(id);
 				}
 			}
+
+			detail::for_each_fanout(fanout_gen, my_wave_data.to_explore, my_wave_data.fanouts, my_wave_data.fanout_ends, [&](const ID& id, const auto& fanouts) {
+				visitor.onExplore(id);
+				for (const auto& fanout : fanouts) {
+					if (!data.reached(fanout) && !should_ignore(fanout)) {
+						my_next_wave.emplace_back(detail::WaveExploration<ID>{id, fanout});
+						visitor.onFanout(id, fanout);
+						my_counts.num_fanouts += 1;
+					} else {
+						visitor.onSkippedFanout(id, fanout);
+						my_counts.num_skipped_fanouts += 1;
+					}
+				}
+			}, detail::Preference<2>());
+
+			my_wave_data.counts = my_counts;
 		};
 
 		if (NTHREADS == 1) {
@@ -216,20 +677,24 @@ auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_l
 		}
 
 		visitor.onExploreEnd();
+
+		WaveCounts wave_counts;
+		for (const auto& waveDatum : waveData) {
+			wave_counts.num_skipped_explores += waveDatum.counts.num_skipped_explores;
+			wave_counts.num_fanouts += waveDatum.counts.num_fanouts;
+			wave_counts.num_skipped_fanouts += waveDatum.counts.num_skipped_fanouts;
+		}
+		visitor.onWaveCounts(wave_counts);
+
 		visitor.onNextWaveCalcStart();
 
+		// the first exploration to reach a vertex is its parent
 		bool found_target = false;
-		explorations_to_new_nodes.clear();
-		in_next_wave.clear();
 		curr_wave.clear();
 		for (auto& waveDatum : waveData) {
 			for (auto& exploreData : waveDatum.next_wave) {
-				if (data.find(exploreData.fanout) == end(data)) {
-					explorations_to_new_nodes.emplace_back(exploreData);
-					if (in_next_wave.find(exploreData.fanout) == end(in_next_wave)) {
-						in_next_wave.emplace(exploreData.fanout);
-						curr_wave.push_back(exploreData.fanout);
-					}
+				if (data.add(exploreData.fanout, exploreData.parent)) {
+					curr_wave.push_back(exploreData.fanout);
 				}
 
 				if (isTarget(exploreData.fanout)) {
@@ -243,10 +708,6 @@ auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_l
 		visitor.onNextWaveCalcEnd();
 		visitor.onDataEntryStart();
 
-		for (const auto& exploreData : explorations_to_new_nodes) {
-			data[exploreData.fanout].fanin.emplace_back(exploreData.parent);
-		}
-
 		if (found_target || curr_wave.empty()) {
 			break;
 		}
@@ -255,6 +716,9 @@ auto wavedBreadthFirstVisit(FanoutGen&& fanout_gen, const InitialList& initial_l
 		visitor.onWaveEnd();
 	}
 
+	util::record_memory("wavedBreadthFirstVisit visit tree", [&]() { return util::heap_bytes(data); });
+	util::record_memory("wavedBreadthFirstVisit wave buffers", [&]() { return util::heap_bytes(curr_wave) + util::heap_bytes(waveData); });
+
 	return data;
 }
 
@@ -1,6 +1,9 @@
 
 #include "logging.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <thread>
 
 IndentingLeveledDebugPrinter dout(std::cout, 0);
 
@@ -93,27 +96,275 @@ namespace DebugLevel {
 
 }
 
-LevelStream::~LevelStream() {
-	// when the caller is done, dump the ss to src;
-	flush();
+namespace {
+	/**
+	 * The indent state of each thread - what it's printing is in its own context
+	 */
+	struct ThreadIndent {
+		int indent_level = 0;
+		bool just_saw_newline = false;
+	};
+
+	ThreadIndent& this_thread_indent() {
+		thread_local ThreadIndent indent;
+		return indent;
+	}
+
+	struct QueuedMessage {
+		std::atomic<QueuedMessage*> next{nullptr};
+		std::string text = "";
+	};
+
+	/**
+	 * A multiple-producer, single-consumer lock-free queue (Vyukov's). Producers
+	 * only do one exchange; the consumer always holds on to one already-consumed
+	 * node, which is what makes that enough.
+	 */
+	class MessageQueue {
+	public:
+		MessageQueue()
+			: head(new QueuedMessage())
+			, tail(head.load())
+		{ }
+
+		MessageQueue(const MessageQueue&) = delete;
+		MessageQueue& operator=(const MessageQueue&) = delete;
+
+		~MessageQueue() {
+			while (tail) {
+				auto next = tail->next.load();
+				delete tail;
+				tail = next;
+			}
+		}
+
+		void push(std::string&& text) {
+			auto message = new QueuedMessage();
+			message->text = std::move(text);
+			const auto prev = head.exchange(message, std::memory_order_acq_rel);
+			prev->next.store(message, std::memory_order_release);
+		}
+
+		/**
+		 * Only from the consumer. False if empty (or if a push is half done - it'll be there next time)
+		 */
+		bool pop(std::string& text) {
+			const auto next = tail->next.load(std::memory_order_acquire);
+			if (!next) {
+				return false;
+			}
+			text = std::move(next->text);
+			delete tail;
+			tail = next;
+			return true;
+		}
+
+	private:
+		std::atomic<QueuedMessage*> head; // the last pushed
+		QueuedMessage* tail; // already consumed - its next is the first unconsumed
+	};
+}
+
+class IndentingLeveledDebugPrinter::AsyncWriter {
+public:
+	explicit AsyncWriter(std::ostream& os)
+		: queue()
+		, num_queued(0)
+		, num_written(0)
+		, stopping(false)
+		, writer_sleeping(false)
+		, mutex()
+		, wake_writer()
+		, written_some()
+		, writer()
+	{
+		writer = std::thread([this, &os]() { writeUntilStopped(os); });
+	}
+
+	AsyncWriter(const AsyncWriter&) = delete;
+	AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+	~AsyncWriter() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake_writer.notify_one();
+		writer.join();
+	}
+
+	void push(std::string&& message) {
+		num_queued.fetch_add(1);
+		queue.push(std::move(message));
+		// pairs with the fence in writeUntilStopped. Without both, this load could be satisfied before
+		// the push is visible to the writer, and each side could miss the other's store.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (writer_sleeping.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			wake_writer.notify_one();
+		}
+	}
+
+	void drain() {
+		const auto target = num_queued.load();
+		std::unique_lock<std::mutex> lock(mutex);
+		written_some.wait(lock, [&]() { return num_written.load() >= target; });
+	}
+
+private:
+	void writeUntilStopped(std::ostream& os) {
+		std::string message;
+		while (true) {
+			std::size_t num_popped = 0;
+			while (queue.pop(message)) {
+				os << message;
+				num_popped += 1;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			if (num_popped != 0) {
+				os.flush();
+				num_written.fetch_add(num_popped);
+				written_some.notify_all();
+				continue;
+			}
+			if (stopping && num_written.load() == num_queued.load()) {
+				return;
+			}
+
+			// pushers check writer_sleeping after pushing, and we check for a message after setting it.
+			// The fences (here and in push) make sure at least one of us sees the other's store.
+			writer_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!queue.pop(message)) {
+				wake_writer.wait(lock);
+			} else {
+				lock.unlock();
+				os << message;
+				lock.lock();
+				num_written.fetch_add(1);
+				written_some.notify_all();
+			}
+			writer_sleeping.store(false);
+		}
+	}
+
+	MessageQueue queue;
+	std::atomic<std::size_t> num_queued;
+	std::atomic<std::size_t> num_written;
+	bool stopping;
+	std::atomic<bool> writer_sleeping;
+	std::mutex mutex;
+	std::condition_variable wake_writer;
+	std::condition_variable written_some;
+	std::thread writer;
+};
+
+IndentingLeveledDebugPrinter::IndentingLeveledDebugPrinter(std::ostream& os, int highest_title_rank)
+	: boost::iostreams::filtering_ostream()
+	, LevelRedirecter()
+	, highest_title_rank(highest_title_rank)
+	, write_mutex()
+	, async_writer()
+{
+	push(os);
+}
+
+IndentingLeveledDebugPrinter::~IndentingLeveledDebugPrinter() {
+	stopAsyncWriter();
+}
+
+void IndentingLeveledDebugPrinter::print(std::istream& ss) {
+	auto& indent = this_thread_indent();
+	std::string message;
+	while (true) {
+		auto c = ss.get();
+		if (ss.eof()) { break; }
+
+		// if we see a newline, remember it, and output spaces next time.
+		if (c == '\n') {
+			indent.just_saw_newline = true;
+		} else if (indent.just_saw_newline) {
+			message.append(getNumSpacesToIndent(), ' ');
+			indent.just_saw_newline = false;
+		}
+
+		message.push_back(static_cast<char>(c));
+	}
+	write(std::move(message));
+}
+
+uint IndentingLeveledDebugPrinter::getIndentLevel() {
+	return static_cast<uint>(this_thread_indent().indent_level);
+}
+
+void IndentingLeveledDebugPrinter::beginIndent() {
+	this_thread_indent().indent_level += 1;
+}
+
+void IndentingLeveledDebugPrinter::endIndent() {
+	auto& indent = this_thread_indent();
+	if (indent.indent_level > 0) {
+		indent.indent_level -= 1;
+	}
+}
+
+void IndentingLeveledDebugPrinter::write(std::string&& message) {
+	if (async_writer) {
+		async_writer->push(std::move(message));
+	} else {
+		std::lock_guard<std::mutex> lock(write_mutex);
+		*this << message;
+		flush(); // ensure each message is printed immediately
+	}
+}
+
+void IndentingLeveledDebugPrinter::setOutput(std::ostream& os) {
+	const bool was_async = async_writer != nullptr;
+	stopAsyncWriter(); // it writes to the old output
+
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		flush();
+		pop();
+		push(os);
+	}
+
+	if (was_async) {
+		startAsyncWriter();
+	}
+}
+
+void IndentingLeveledDebugPrinter::startAsyncWriter() {
+	if (!async_writer) {
+		async_writer = std::make_unique<AsyncWriter>(static_cast<std::ostream&>(*this));
+	}
+}
+
+void IndentingLeveledDebugPrinter::stopAsyncWriter() {
+	async_writer.reset();
+}
+
+void IndentingLeveledDebugPrinter::drain() {
+	if (async_writer) {
+		async_writer->drain();
+	}
 }
 
 void LevelStream::flush() {
-	if (enabled()) {
-		src->print(underlying_ss);
+	if (enabled() && underlying_ss) {
+		src->print(*underlying_ss);
+		underlying_ss->str("");
+		underlying_ss->clear();
 	}
-	underlying_ss.clear();
 }
 
 void IndentLevel::endIndent() {
+	if (src && !ended && profiled) {
+		util::Profiler::get().endScope();
+	}
 	ended = true;
 	if (src) {
 		src->endIndent();
 	}
 }
-
-IndentLevel::~IndentLevel() {
-	if (src && !ended) {
-		src->endIndent();
-	}
-}
@@ -2,11 +2,14 @@
 #ifndef UTIL__LOGGING_H
 #define UTIL__LOGGING_H
 
+#include <util/profiler.hpp>
 #include <util/utils.hpp>
 
 #include <bitset>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -45,6 +48,17 @@ namespace DebugLevel {
 		LEVEL_COUNT, // please make sure this is at the end
 	};
 
+	/**
+	 * Printing to this level or any after it is compiled out - dout(l) is always disabled, and
+	 * with a constant l the compiler removes the print entirely. Set at build time with
+	 * -D DOUT_COMPILED_LEVEL_LIMIT=<level name>. Enabling those levels at runtime does nothing.
+	 */
+#ifdef DOUT_COMPILED_LEVEL_LIMIT
+	constexpr Level COMPILED_LEVEL_LIMIT = DOUT_COMPILED_LEVEL_LIMIT;
+#else
+	constexpr Level COMPILED_LEVEL_LIMIT = LEVEL_COUNT;
+#endif
+
 	/**
 	 * Get the default set of print levels that should probably always be enabled
 	 * Most code assumes these are already on.
@@ -120,7 +134,7 @@ public:
 	LevelRedirecter& operator=(LevelRedirecter&&) = default;
 
 	REDIRECT_TYPE operator()(const LEVEL_TYPE& level) {
-		if (enabled_levels.test(level)) {
+		if (enabled_levels[level]) {
 			return REDIRECT_TYPE(STREAM_GET_TYPE()(this));
 		} else {
 			return REDIRECT_TYPE(nullptr);
@@ -166,16 +180,22 @@ public:
 /**
  * A little helper class that is returned when an indent is done
  * It will either unindent when its destructor is called, or endIndent() is called
+ * If the indent was started while the util::Profiler was enabled, it also ends the profiler scope.
  */
 class IndentLevel {
 	friend class IndentingLeveledDebugPrinter;
 	friend class LevelStream;
 	IndentingLeveledDebugPrinter* src;
 	bool ended;
-	IndentLevel(IndentingLeveledDebugPrinter* src) : src(src), ended(false) { }
+	bool profiled;
+	IndentLevel(IndentingLeveledDebugPrinter* src, bool profiled = false) : src(src), ended(false), profiled(profiled) { }
 public:
 	void endIndent();
-	~IndentLevel();
+	~IndentLevel() {
+		if (src && !ended) {
+			endIndent();
+		}
+	}
 
 	/**
 	 * Move Constructor - disable the old one, but otherwise copy everything over
@@ -183,6 +203,7 @@ public:
 	IndentLevel(IndentLevel&& src_ilevel)
 		: src(std::move(src_ilevel.src))
 		, ended(std::move(src_ilevel.ended))
+		, profiled(src_ilevel.profiled)
 	{
 		src_ilevel.ended = true;
 	}
@@ -196,6 +217,7 @@ public:
 	IndentLevel& operator=(IndentLevel&& rhs) {
 		this->src = std::move(rhs.src);
 		this->ended = std::move(rhs.ended);
+		this->profiled = rhs.profiled;
 		rhs.ended = true;
 		return *this;
 	}
@@ -208,26 +230,35 @@ public:
  * A helper class for actually printing. IndentingLeveledDebugPrinter doesn't
  * actually have operator<< defined, so that you have to use operator() to print.
  * (it returns an object of this class)
+ *
+ * Everything pushed in is collected here, and handed over as one message when
+ * this is destroyed (or flushed), so messages from different threads don't mix.
+ * A disabled one doesn't even make a buffer.
  */
 class LevelStream {
 private:
 	friend class IndentingLeveledDebugPrinter;
 
 	IndentingLeveledDebugPrinter* src;
-	std::stringstream underlying_ss;
+	std::unique_ptr<std::stringstream> underlying_ss;
 
 public:
 	LevelStream(IndentingLeveledDebugPrinter* src)
 		: src(src)
-		, underlying_ss()
+		, underlying_ss(src ? std::make_unique<std::stringstream>() : nullptr)
 	{ }
 
-	LevelStream(const LevelStream&) = default;
+	LevelStream(const LevelStream&) = delete;
 	LevelStream(LevelStream&&) = default;
 
-	~LevelStream();
+	~LevelStream() {
+		// when the caller is done, dump the ss to src;
+		if (enabled()) {
+			flush();
+		}
+	}
 
-	LevelStream& operator=(const LevelStream&) = default;
+	LevelStream& operator=(const LevelStream&) = delete;
 	LevelStream& operator=(LevelStream&&) = default;
 
 	template<typename T>
@@ -239,7 +270,7 @@ public:
 	template<typename T>
 	LevelStream& push_in(const T& t) {
 		if (enabled()) {
-			underlying_ss << t;
+			*underlying_ss << t;
 		}
 		return *this;
 	}
@@ -256,6 +287,10 @@ public:
  * The highest_title_rank controls how many '=' to put around the title of the indent level at
  * the default level. Each inner level will be indented one tab stop, and have one fewer '=' on
  * each side of the title's text - with a minimum of one.
+ *
+ * Indent levels are kept per thread, and it can be printed to from any thread. Each message
+ * is indented by the thread that printed it, then written out whole - either right away (under
+ * a lock), or, after startAsyncWriter(), queued for a background thread to write.
  */
 class IndentingLeveledDebugPrinter
 	: private boost::iostreams::filtering_ostream
@@ -266,63 +301,73 @@ class IndentingLeveledDebugPrinter
 		, DebugLevel::LEVEL_COUNT
 	>
 {
+	class AsyncWriter;
+
 	int highest_title_rank;
-	int indent_level;
+	std::mutex write_mutex;
+	std::unique_ptr<AsyncWriter> async_writer;
 
-	bool just_saw_newline;
 public:
 
-	IndentingLeveledDebugPrinter(std::ostream& os, int highest_title_rank)
-		: boost::iostreams::filtering_ostream()
-		, LevelRedirecter()
-		, highest_title_rank(highest_title_rank)
-		, indent_level(0)
-		, just_saw_newline(false)
-	{
-		push(os);
-	}
+	IndentingLeveledDebugPrinter(std::ostream& os, int highest_title_rank);
+	~IndentingLeveledDebugPrinter();
 
 	IndentingLeveledDebugPrinter(const IndentingLeveledDebugPrinter&) = delete;
 	IndentingLeveledDebugPrinter& operator=(const IndentingLeveledDebugPrinter&) = delete;
 
-	void print(std::istream& ss) {
-		while (true) {
-			auto c = ss.get();
-			if (ss.eof()) { break; }
-
-			// if we see a newline, remember it, and output spaces next time.
-			if (c == '\n') {
-				just_saw_newline = true;
-			} else if (just_saw_newline) {
-				util::repeat(getNumSpacesToIndent(),[&](){
-					this->put(' ');
-				});
-				just_saw_newline = false;
-			}
-
-			this->put((char_type)c);
+	/**
+	 * Same as LevelRedirecter's, except levels past DebugLevel::COMPILED_LEVEL_LIMIT are never enabled
+	 */
+	LevelStream operator()(const DebugLevel::Level& level) {
+		if (level >= DebugLevel::COMPILED_LEVEL_LIMIT) {
+			return LevelStream(nullptr);
 		}
-		flush(); // ensure each ss is printed immediately
+		return LevelRedirecter::operator()(level);
 	}
 
-	uint getIndentLevel() {
-		return indent_level;
-	}
+	void print(std::istream& ss);
+
+	uint getIndentLevel();
 
 	uint getNumSpacesToIndent() {
-		return indent_level * 2;
+		return getIndentLevel() * 2;
 	}
 
 	uint getTitleLevel() {
+		const auto indent_level = static_cast<int>(getIndentLevel());
 		if (indent_level >= highest_title_rank) {
 			return 1;
 		} else {
-			return highest_title_rank-indent_level;
+			return static_cast<uint>(highest_title_rank-indent_level);
 		}
 	}
 
 	void setHighestTitleRank(int level) { highest_title_rank = level; }
 
+	/**
+	 * Write everything printed from here on to os instead - eg. to stderr, when stdout
+	 * is for a program's results. Call from one thread, while nothing else is printing.
+	 */
+	void setOutput(std::ostream& os);
+
+	/**
+	 * From here on, messages are put on a lock-free queue, and a background thread
+	 * writes them out. Call from one thread, while nothing else is printing.
+	 */
+	void startAsyncWriter();
+
+	/**
+	 * Write out everything queued, then go back to writing directly. Also done on destruction.
+	 * Call from one thread, while nothing else is printing.
+	 */
+	void stopAsyncWriter();
+
+	/**
+	 * Wait until everything printed so far (by any thread) has been written out -
+	 * eg. before writing to the same stream some other way, or exiting abnormally.
+	 */
+	void drain();
+
 private:
 	friend class IndentLevel;
 	friend class LevelStream;
@@ -331,24 +376,29 @@ private:
 	auto indentWithTitle(const FUNC& f) -> decltype(f(std::stringstream()),IndentLevel(this)) {
 		// the weird return value is so the compiler SFINAE's away this
 		// overload if FUNC is not a lambda style type
+		std::stringstream title_ss;
+		f(title_ss);
+		const auto title = title_ss.str();
+
 		std::stringstream local_ss;
 
 		util::repeat(getTitleLevel(),[&](){
 			local_ss << '=';
 		});
-		local_ss << ' ';
-
-		f(local_ss);
-
-		local_ss << ' ';
+		local_ss << ' ' << title << ' ';
 		util::repeat(getTitleLevel(),[&](){
 			local_ss << '=';
 		});
 		local_ss << '\n';
 
 		print(local_ss);
-		indent_level++;
-		return IndentLevel(this);
+		beginIndent();
+
+		const bool profiled = util::Profiler::isEnabled();
+		if (profiled) {
+			util::Profiler::get().beginScope(title);
+		}
+		return IndentLevel(this, profiled);
 	}
 
 	IndentLevel indentWithTitle(const std::string& title) {
@@ -359,11 +409,13 @@ private:
 		return indentWithTitle([&](auto&& s){ s << title; });
 	}
 
-	void endIndent() {
-		if (indent_level > 0) {
-			indent_level = indent_level - 1;
-		}
-	}
+	void beginIndent();
+	void endIndent();
+
+	/**
+	 * Write out a formatted message, or queue it to be
+	 */
+	void write(std::string&& message);
 };
 
 extern IndentingLeveledDebugPrinter dout;
@@ -395,6 +447,7 @@ namespace util {
 		std::ostringstream os;
 		func(os);
 		dout(level) << '\n' << os.str() << '\n';
+		dout.drain(); // in case nothing catches it
 		throw EXCEPTION(os.str());
 	}
 }
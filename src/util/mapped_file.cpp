@@ -0,0 +1,80 @@
+#include "mapped_file.hpp"
+
+#include <util/logging.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace util {
+
+MappedFile::MappedFile(const std::string& file_name, DebugLevel::Level error_level)
+	: mapping(nullptr)
+	, length(0)
+{
+	const auto throw_with_errno = [&](const char* what) {
+		const auto error_number = errno;
+		util::print_and_throw<std::runtime_error>([&](auto&& str) {
+			str << "couldn't " << what << ' ' << file_name << ": " << std::strerror(error_number);
+		}, error_level);
+	};
+
+	const int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw_with_errno("open");
+	}
+
+	struct stat file_stat;
+	if (::fstat(fd, &file_stat) != 0) {
+		::close(fd);
+		throw_with_errno("stat");
+	}
+	length = static_cast<std::size_t>(file_stat.st_size);
+
+	if (length != 0) {
+		mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			mapping = nullptr;
+			::close(fd);
+			throw_with_errno("mmap");
+		}
+	}
+
+	::close(fd); // the mapping keeps the file alive
+}
+
+MappedFile::~MappedFile() {
+	if (mapping) {
+		::munmap(mapping, length);
+	}
+}
+
+void write_file_atomically(const std::string& file_name, const char* data, std::size_t size) {
+	const auto temp_file_name = file_name + ".tmp." + std::to_string(::getpid());
+
+	{
+		std::ofstream os(temp_file_name, std::ios::binary | std::ios::trunc);
+		os.write(data, static_cast<std::streamsize>(size));
+		if (!os) {
+			util::print_and_throw<std::runtime_error>([&](auto&& str) {
+				str << "couldn't write " << temp_file_name;
+			});
+		}
+	}
+
+	if (std::rename(temp_file_name.c_str(), file_name.c_str()) != 0) {
+		const auto error_number = errno;
+		std::remove(temp_file_name.c_str());
+		util::print_and_throw<std::runtime_error>([&](auto&& str) {
+			str << "couldn't rename " << temp_file_name << " to " << file_name << ": " << std::strerror(error_number);
+		});
+	}
+}
+
+} // end namespace util
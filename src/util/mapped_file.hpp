@@ -0,0 +1,42 @@
+#ifndef UTIL__MAPPED_FILE_H
+#define UTIL__MAPPED_FILE_H
+
+#include <util/logging.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace util {
+
+/**
+ * A read-only memory mapping of a whole file. The mapping is shared with
+ * any other process that maps the same file, and lives as long as this object.
+ * Throws std::runtime_error if the file can't be opened or mapped, which is printed
+ * at error_level (lower it where that's expected, like a cache file that isn't there yet).
+ */
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& file_name, DebugLevel::Level error_level = DebugLevel::Level::ERROR);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return static_cast<const char*>(mapping); }
+	std::size_t size() const { return length; }
+
+private:
+	void* mapping;
+	std::size_t length;
+};
+
+/**
+ * Writes the data to a temporary file next to file_name, then renames it into
+ * place, so that concurrent readers never see a partially written file.
+ * Throws std::runtime_error on failure.
+ */
+void write_file_atomically(const std::string& file_name, const char* data, std::size_t size);
+
+} // end namespace util
+
+#endif // UTIL__MAPPED_FILE_H
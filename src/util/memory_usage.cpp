@@ -0,0 +1,114 @@
+#include "memory_usage.hpp"
+
+#include <util/logging.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+
+#include <malloc.h>
+
+namespace util {
+
+std::atomic<bool> MemoryLedger::enabled_flag{false};
+
+namespace {
+	std::mutex ledger_mutex;
+	std::map<std::string, MemoryLedger::Entry> ledger_entries;
+
+	/**
+	 * Reads a "Name:   1234 kB" line out of /proc/self/status
+	 */
+	std::size_t read_proc_status_bytes(const std::string& field_name) {
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.compare(0, field_name.size() + 1, field_name + ':') == 0) {
+				std::istringstream fields(line.substr(field_name.size() + 1));
+				std::size_t kibibytes = 0;
+				fields >> kibibytes;
+				return kibibytes*1024;
+			}
+		}
+		return 0;
+	}
+
+	double as_mebibytes(std::size_t bytes) {
+		return static_cast<double>(bytes)/(1024.0*1024.0);
+	}
+}
+
+std::size_t current_rss_bytes() {
+	return read_proc_status_bytes("VmRSS");
+}
+
+std::size_t peak_rss_bytes() {
+	return read_proc_status_bytes("VmHWM");
+}
+
+std::size_t heap_bytes_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	const auto info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+MemoryLedger& MemoryLedger::get() {
+	static MemoryLedger ledger;
+	return ledger;
+}
+
+void MemoryLedger::record(const std::string& name, std::size_t bytes) {
+	std::lock_guard<std::mutex> lock(ledger_mutex);
+	auto& entry = ledger_entries.emplace(name, Entry{0, 0, 0, 0}).first->second;
+	entry.count += 1;
+	entry.last_bytes = bytes;
+	entry.peak_bytes = std::max(entry.peak_bytes, bytes);
+	entry.total_bytes += bytes;
+}
+
+std::map<std::string, MemoryLedger::Entry> MemoryLedger::entries() const {
+	std::lock_guard<std::mutex> lock(ledger_mutex);
+	return ledger_entries;
+}
+
+void MemoryLedger::writeReport(std::ostream& os) const {
+	os << std::fixed << std::setprecision(3);
+	os << "peak RSS: " << as_mebibytes(peak_rss_bytes()) << " MiB\n";
+	os << "current RSS: " << as_mebibytes(current_rss_bytes()) << " MiB\n";
+	os << "heap in use: " << as_mebibytes(heap_bytes_in_use()) << " MiB\n";
+
+	os << std::setw(10) << "count" << std::setw(14) << "peak MiB" << std::setw(14) << "last MiB" << std::setw(14) << "mean MiB" << "  structure\n";
+	for (const auto& name_and_entry : entries()) {
+		const auto& entry = name_and_entry.second;
+		os << std::setw(10) << entry.count
+			<< std::setw(14) << as_mebibytes(entry.peak_bytes)
+			<< std::setw(14) << as_mebibytes(entry.last_bytes)
+			<< std::setw(14) << as_mebibytes(entry.total_bytes)/static_cast<double>(entry.count)
+			<< "  " << name_and_entry.first << '\n';
+	}
+	os << std::defaultfloat;
+}
+
+PeakRSSReporter::~PeakRSSReporter() {
+	const auto peak_rss = peak_rss_bytes();
+	if (peak_rss != 0) {
+		std::ostringstream mebibytes;
+		mebibytes << std::fixed << std::setprecision(1) << as_mebibytes(peak_rss);
+		dout(DL::INFO) << "peak RSS after " << flow_name << ": " << mebibytes.str() << " MiB\n";
+	}
+}
+
+void write_memory_report() {
+	const auto indent = dout(DL::INFO).indentWithTitle("Memory Report");
+	std::ostringstream report;
+	MemoryLedger::get().writeReport(report);
+	dout(DL::INFO) << report.str();
+}
+
+} // end namespace util
@@ -0,0 +1,172 @@
+#ifndef UTIL__MEMORY_USAGE_H
+#define UTIL__MEMORY_USAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * The process' resident set size now, and the most it has ever been
+ * (VmRSS & VmHWM in /proc/self/status). 0 if they can't be read.
+ */
+std::size_t current_rss_bytes();
+std::size_t peak_rss_bytes();
+
+/**
+ * What malloc has handed out and not had back yet - ie. all live new'd memory.
+ * 0 if the C library can't say.
+ */
+std::size_t heap_bytes_in_use();
+
+/**
+ * Estimates of the heap memory owned by a data structure, including what its elements own.
+ * Node based containers are estimated using libstdc++'s node layouts.
+ * Classes can take part by having a `std::size_t heap_bytes() const` member.
+ */
+template<typename T> std::size_t heap_bytes(const T& t);
+template<typename T, typename A> std::size_t heap_bytes(const std::vector<T, A>& v);
+template<typename K, typename V, typename C, typename A> std::size_t heap_bytes(const std::map<K, V, C, A>& m);
+template<typename K, typename V, typename H, typename E, typename A> std::size_t heap_bytes(const std::unordered_map<K, V, H, E, A>& m);
+template<typename K, typename H, typename E, typename A> std::size_t heap_bytes(const std::unordered_set<K, H, E, A>& s);
+template<typename T1, typename T2> std::size_t heap_bytes(const std::pair<T1, T2>& p);
+
+namespace detail {
+	template<typename T>
+	auto heap_bytes_of(const T& t, int) -> decltype(std::size_t(t.heap_bytes())) {
+		return t.heap_bytes();
+	}
+
+	template<typename T>
+	std::size_t heap_bytes_of(const T&, long) {
+		return 0;
+	}
+
+	template<typename Container>
+	std::size_t heap_bytes_of_elements(const Container& c) {
+		std::size_t result = 0;
+		for (const auto& elem : c) {
+			result += heap_bytes(elem);
+		}
+		return result;
+	}
+
+	template<typename Value>
+	constexpr std::size_t hash_node_bytes() {
+		// next pointer & cached hash, then the value
+		return 2*sizeof(void*) + sizeof(Value);
+	}
+}
+
+template<typename T>
+std::size_t heap_bytes(const T& t) {
+	return detail::heap_bytes_of(t, 0);
+}
+
+template<typename T, typename A>
+std::size_t heap_bytes(const std::vector<T, A>& v) {
+	return v.capacity()*sizeof(T) + detail::heap_bytes_of_elements(v);
+}
+
+template<typename K, typename V, typename C, typename A>
+std::size_t heap_bytes(const std::map<K, V, C, A>& m) {
+	// colour, parent, left & right, then the value
+	const std::size_t node_bytes = 4*sizeof(void*) + sizeof(typename std::map<K, V, C, A>::value_type);
+	return m.size()*node_bytes + detail::heap_bytes_of_elements(m);
+}
+
+template<typename K, typename V, typename H, typename E, typename A>
+std::size_t heap_bytes(const std::unordered_map<K, V, H, E, A>& m) {
+	return m.bucket_count()*sizeof(void*)
+		+ m.size()*detail::hash_node_bytes<typename std::unordered_map<K, V, H, E, A>::value_type>()
+		+ detail::heap_bytes_of_elements(m);
+}
+
+template<typename K, typename H, typename E, typename A>
+std::size_t heap_bytes(const std::unordered_set<K, H, E, A>& s) {
+	return s.bucket_count()*sizeof(void*)
+		+ s.size()*detail::hash_node_bytes<K>()
+		+ detail::heap_bytes_of_elements(s);
+}
+
+template<typename T1, typename T2>
+std::size_t heap_bytes(const std::pair<T1, T2>& p) {
+	return heap_bytes(p.first) + heap_bytes(p.second);
+}
+
+/**
+ * The sizes of the major data structures, recorded by name where they're built.
+ * Nothing is recorded (or computed - see record_memory) unless it's enabled.
+ * Can be recorded to from any thread.
+ */
+class MemoryLedger {
+public:
+	struct Entry {
+		std::size_t count;
+		std::size_t last_bytes;
+		std::size_t peak_bytes;
+		std::size_t total_bytes;
+	};
+
+	static MemoryLedger& get();
+
+	static bool isEnabled() { return enabled_flag.load(std::memory_order_relaxed); }
+	void enable() { enabled_flag.store(true); }
+
+	void record(const std::string& name, std::size_t bytes);
+
+	std::map<std::string, Entry> entries() const;
+
+	/**
+	 * Writes the peak & current RSS, the heap in use, and a table of what was recorded
+	 */
+	void writeReport(std::ostream& os) const;
+
+private:
+	MemoryLedger() = default;
+
+	static std::atomic<bool> enabled_flag;
+};
+
+/**
+ * Records the result of compute_bytes() under name, if the ledger is enabled.
+ */
+template<typename ComputeBytes>
+void record_memory(const std::string& name, ComputeBytes&& compute_bytes) {
+	if (MemoryLedger::isEnabled()) {
+		MemoryLedger::get().record(name, compute_bytes());
+	}
+}
+
+/**
+ * Prints the peak RSS to dout(DL::INFO) when it goes out of scope -
+ * put one at the top of each flow.
+ */
+class PeakRSSReporter {
+public:
+	explicit PeakRSSReporter(std::string flow_name) : flow_name(std::move(flow_name)) { }
+	~PeakRSSReporter();
+
+	PeakRSSReporter(const PeakRSSReporter&) = delete;
+	PeakRSSReporter& operator=(const PeakRSSReporter&) = delete;
+
+private:
+	std::string flow_name;
+};
+
+/**
+ * For the end of a program run with --memory-report: writes MemoryLedger's report to dout(DL::INFO)
+ */
+void write_memory_report();
+
+} // end namespace util
+
+#endif // UTIL__MEMORY_USAGE_H
@@ -1,11 +1,13 @@
 #ifndef UTIL__NETLIST_H
 #define UTIL__NETLIST_H
 
+#include <util/flat_hash.hpp>
 #include <util/generator.hpp>
 
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <stdexcept>
 #include <sstream>
 
@@ -54,6 +56,52 @@ public:
 		}
 	}
 
+	/**
+	 * Remove the connection, and any node left with no connections at all.
+	 * Only for forests, where the sink can't have another parent.
+	 */
+	void removeConnection(const NODE_ID& source, const NODE_ID& sink) {
+		static_assert(IS_FOREST, "removing connections is only supported for forests");
+
+		const auto source_location = connections.find(source);
+		if (source_location == end(connections) || source_location->second.erase(sink) == 0) {
+			return;
+		}
+
+		const auto sink_location = connections.find(sink);
+		if (sink_location->second.empty()) {
+			connections.erase(sink_location);
+		} else {
+			m_roots.insert(sink);
+		}
+
+		if (source_location->second.empty() && m_roots.find(source) != end(m_roots)) {
+			connections.erase(source_location);
+			m_roots.erase(source);
+		}
+	}
+
+	/**
+	 * Remove the tree rooted at root. Returns everything that was in it.
+	 */
+	std::vector<NODE_ID> removeTree(const NODE_ID& root) {
+		static_assert(IS_FOREST, "removing trees is only supported for forests");
+
+		if (m_roots.erase(root) == 0) {
+			std::stringstream err_str;
+			err_str << "can't remove the tree at " << root << ", as it isn't a root";
+			throw std::invalid_argument(err_str.str());
+		}
+
+		std::vector<NODE_ID> removed{root};
+		for (std::size_t i = 0; i < removed.size(); ++i) {
+			const auto location = connections.find(removed[i]);
+			removed.insert(end(removed), begin(location->second), end(location->second));
+			connections.erase(location);
+		}
+		return removed;
+	}
+
 	bool empty() const { return connections.empty(); }
 
 	auto& roots() const { return m_roots; }
@@ -81,7 +129,7 @@ public:
 	template<typename VisitorState, typename Visitor>
 	auto for_all_descendants(NODE_ID start, VisitorState&& initial_state, Visitor&& visitor) const {
 		std::list<std::pair<NODE_ID, VisitorState>> to_visit;
-		std::unordered_set<NODE_ID> visited;
+		util::FlatHashSet<NODE_ID> visited;
 		to_visit.emplace_back(start, initial_state);
 
 		while (!to_visit.empty()) {
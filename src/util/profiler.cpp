@@ -0,0 +1,230 @@
+#include "profiler.hpp"
+
+#include <util/logging.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <mutex>
+#include <ostream>
+
+namespace util {
+
+std::atomic<bool> Profiler::enabled_flag{false};
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * Each thread only appends to its own log, so the lock is never contended while profiling
+	 */
+	struct ThreadLog {
+		explicit ThreadLog(std::uint32_t thread_number) : thread_number(thread_number), mutex(), events() { }
+
+		const std::uint32_t thread_number;
+		mutable std::mutex mutex;
+		std::vector<Profiler::Event> events;
+	};
+
+	struct OpenScope {
+		std::string name;
+		std::string path;
+		Clock::time_point wall_start;
+		double cpu_start_us;
+		double enclosed_wall_us;
+	};
+
+	struct ThreadState {
+		ThreadLog* log = nullptr;
+		std::vector<OpenScope> open_scopes = {};
+	};
+
+	std::mutex thread_logs_mutex;
+	std::list<ThreadLog> thread_logs; // a list, so that they don't move
+	Clock::time_point profile_start;
+
+	ThreadState& this_thread_state() {
+		thread_local ThreadState state;
+		if (!state.log) {
+			std::lock_guard<std::mutex> lock(thread_logs_mutex);
+			thread_logs.emplace_back(static_cast<std::uint32_t>(thread_logs.size()));
+			state.log = &thread_logs.back();
+		}
+		return state;
+	}
+
+	double thread_cpu_us() {
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return static_cast<double>(ts.tv_sec)*1e6 + static_cast<double>(ts.tv_nsec)/1e3;
+	}
+
+	double us_between(Clock::time_point from, Clock::time_point to) {
+		return std::chrono::duration<double, std::micro>(to - from).count();
+	}
+
+	std::string json_escaped(const std::string& str) {
+		std::string result;
+		for (const auto& c : str) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+				result += c;
+			} else if (static_cast<unsigned char>(c) < 0x20) {
+				result += ' ';
+			} else {
+				result += c;
+			}
+		}
+		return result;
+	}
+
+	std::string with_numbers_collapsed(const std::string& str) {
+		std::string result;
+		for (const auto& c : str) {
+			if ('0' <= c && c <= '9') {
+				if (result.empty() || result.back() != '#') {
+					result += '#';
+				}
+			} else {
+				result += c;
+			}
+		}
+		return result;
+	}
+}
+
+Profiler& Profiler::get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+void Profiler::enable() {
+	{
+		std::lock_guard<std::mutex> lock(thread_logs_mutex);
+		profile_start = Clock::now();
+	}
+	enabled_flag.store(true);
+}
+
+void Profiler::beginScope(std::string name) {
+	auto& state = this_thread_state();
+	auto path = state.open_scopes.empty() ? name : state.open_scopes.back().path + " / " + name;
+	state.open_scopes.push_back(OpenScope{std::move(name), std::move(path), Clock::now(), thread_cpu_us(), 0.0});
+}
+
+void Profiler::endScope() {
+	const auto wall_end = Clock::now();
+	const auto cpu_end = thread_cpu_us();
+
+	auto& state = this_thread_state();
+	if (state.open_scopes.empty()) {
+		return;
+	}
+
+	auto& scope = state.open_scopes.back();
+	const auto wall_us = us_between(scope.wall_start, wall_end);
+	{
+		std::lock_guard<std::mutex> lock(state.log->mutex);
+		state.log->events.push_back(Event{
+			std::move(scope.name),
+			std::move(scope.path),
+			state.log->thread_number,
+			static_cast<std::uint32_t>(state.open_scopes.size() - 1),
+			us_between(profile_start, scope.wall_start),
+			wall_us,
+			wall_us - scope.enclosed_wall_us,
+			cpu_end - scope.cpu_start_us,
+		});
+	}
+	state.open_scopes.pop_back();
+
+	if (!state.open_scopes.empty()) {
+		state.open_scopes.back().enclosed_wall_us += wall_us;
+	}
+}
+
+std::vector<Profiler::Event> Profiler::events() const {
+	std::vector<Event> result;
+	std::lock_guard<std::mutex> lock(thread_logs_mutex);
+	for (const auto& log : thread_logs) {
+		std::lock_guard<std::mutex> log_lock(log.mutex);
+		result.insert(end(result), begin(log.events), end(log.events));
+	}
+	return result;
+}
+
+void Profiler::writeChromeTrace(std::ostream& os) const {
+	const auto all_events = events();
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto& event : all_events) {
+		os << (first ? "\n" : ",\n")
+			<< "{\"name\":\"" << json_escaped(event.name) << '"'
+			<< ",\"cat\":\"scope\",\"ph\":\"X\",\"pid\":1"
+			<< ",\"tid\":" << event.thread_number
+			<< ",\"ts\":" << std::fixed << std::setprecision(3) << event.start_us
+			<< ",\"dur\":" << event.wall_us
+			<< ",\"args\":{\"path\":\"" << json_escaped(event.path) << '"'
+			<< ",\"cpu_us\":" << event.cpu_us
+			<< ",\"self_us\":" << event.self_wall_us << "}}"
+			<< std::defaultfloat;
+		first = false;
+	}
+	os << "\n]}\n";
+}
+
+void Profiler::writeSummary(std::ostream& os) const {
+	struct Totals {
+		std::size_t calls = 0;
+		double wall_us = 0;
+		double self_wall_us = 0;
+		double cpu_us = 0;
+	};
+
+	std::map<std::string, Totals> totals_by_path;
+	for (const auto& event : events()) {
+		auto& totals = totals_by_path[with_numbers_collapsed(event.path)];
+		totals.calls += 1;
+		totals.wall_us += event.wall_us;
+		totals.self_wall_us += event.self_wall_us;
+		totals.cpu_us += event.cpu_us;
+	}
+
+	std::vector<std::pair<std::string, Totals>> rows(begin(totals_by_path), end(totals_by_path));
+	std::stable_sort(begin(rows), end(rows), [](const auto& lhs, const auto& rhs) {
+		return lhs.second.wall_us > rhs.second.wall_us;
+	});
+
+	os << std::setw(10) << "calls" << std::setw(14) << "wall ms" << std::setw(14) << "self ms" << std::setw(14) << "cpu ms" << "  path\n";
+	os << std::fixed << std::setprecision(3);
+	for (const auto& row : rows) {
+		os << std::setw(10) << row.second.calls
+			<< std::setw(14) << row.second.wall_us/1e3
+			<< std::setw(14) << row.second.self_wall_us/1e3
+			<< std::setw(14) << row.second.cpu_us/1e3
+			<< "  " << row.first << '\n';
+	}
+	os << std::defaultfloat;
+}
+
+void write_profile_report(const std::string& trace_file_name) {
+	std::ofstream trace_file(trace_file_name);
+	if (!trace_file) {
+		util::print_and_throw<std::invalid_argument>([&](auto&& str) {
+			str << "couldn't open profile trace file " << trace_file_name;
+		});
+	}
+	Profiler::get().writeChromeTrace(trace_file);
+
+	const auto indent = dout(DL::INFO).indentWithTitle("Profile");
+	std::ostringstream summary;
+	Profiler::get().writeSummary(summary);
+	dout(DL::INFO) << summary.str() << "wrote trace to " << trace_file_name << '\n';
+}
+
+} // end namespace util
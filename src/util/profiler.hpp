@@ -0,0 +1,72 @@
+#ifndef UTIL__PROFILER_H
+#define UTIL__PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace util {
+
+/**
+ * Records the wall time, CPU time and nesting of named scopes, per thread.
+ * The dout indentWithTitle scopes are recorded automatically while it's enabled,
+ * with the title as the name, so the flows' existing structure is what gets profiled.
+ *
+ * Scopes can be opened and closed from any thread, but the results should only be
+ * written out once the threads are done.
+ */
+class Profiler {
+public:
+	struct Event {
+		std::string name;
+		std::string path; // the names of this and all enclosing scopes on this thread, separated by " / "
+		std::uint32_t thread_number;
+		std::uint32_t depth;
+		double start_us; // since the profiler was enabled
+		double wall_us;
+		double self_wall_us; // excluding enclosed scopes
+		double cpu_us; // this thread's CPU time
+	};
+
+	static Profiler& get();
+
+	static bool isEnabled() { return enabled_flag.load(std::memory_order_relaxed); }
+	void enable();
+
+	void beginScope(std::string name);
+	void endScope();
+
+	/**
+	 * Everything recorded so far, in the order the scopes ended, thread by thread
+	 */
+	std::vector<Event> events() const;
+
+	/**
+	 * Writes a JSON file for chrome://tracing (or Perfetto) - one complete event per scope
+	 */
+	void writeChromeTrace(std::ostream& os) const;
+
+	/**
+	 * Writes a table of call count, wall time, self time and CPU time for each scope path.
+	 * Runs of digits in paths are replaced by '#', so that scopes like
+	 * "Trying track width of 5" and "... of 6" are summed together.
+	 */
+	void writeSummary(std::ostream& os) const;
+
+private:
+	Profiler() = default;
+
+	static std::atomic<bool> enabled_flag;
+};
+
+/**
+ * For the end of a program run with profiling: write the Chrome trace to
+ * trace_file_name, and the summary to dout(DL::INFO). Throws if the file can't be opened.
+ */
+void write_profile_report(const std::string& trace_file_name);
+
+} // end namespace util
+
+#endif // UTIL__PROFILER_H
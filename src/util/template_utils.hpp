@@ -1,6 +1,10 @@
 #ifndef UTIL__TEMPLATE_UTILS_H
 #define UTIL__TEMPLATE_UTILS_H
 
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
 namespace util {
 
 template<typename... Ts>
@@ -14,6 +18,9 @@ auto forceInstantiation(type_vector<Devices...>) {
 template<typename T>
 using add_pointer_to_const_t = std::add_pointer_t<std::add_const_t<T>>;
 
+template<typename T>
+using shared_ptr_to_const_t = std::shared_ptr<std::add_const_t<T>>;
+
 template <typename T>
 using same_type = T;
 
@@ -0,0 +1,63 @@
+#include "../logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Many threads print bursts through the asynchronous writer, and after each burst
+ * everything must be written out by drain(). A lost wakeup of the writer shows up as
+ * a drain() that never returns, so that's given a (generous) time limit.
+ */
+void async_writer_drains_every_burst() {
+	const int num_threads = 4;
+	const int num_bursts = 2000;
+	const int messages_per_burst = 8;
+
+	std::ostringstream out;
+	IndentingLeveledDebugPrinter printer(out, 0);
+	printer.enable_level(DL::INFO);
+	printer.startAsyncWriter();
+
+	for (int iburst = 0; iburst < num_bursts; ++iburst) {
+		std::vector<std::thread> threads;
+		for (int ithread = 0; ithread < num_threads; ++ithread) {
+			threads.emplace_back([&, ithread]() {
+				for (int imessage = 0; imessage < messages_per_burst; ++imessage) {
+					printer(DL::INFO) << "burst " << iburst << " thread " << ithread << " message " << imessage << '\n';
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		const auto num_expected_lines = static_cast<std::size_t>(num_threads*messages_per_burst);
+
+		auto drained = std::async(std::launch::async, [&]() { printer.drain(); });
+		if (drained.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+			std::cerr << "drain() didn't return after burst " << iburst << " - the writer missed a message\n";
+			std::terminate();
+		}
+
+		// the writer is idle now, so this is safe
+		const auto text = out.str();
+		out.str("");
+		const auto num_lines = static_cast<std::size_t>(std::count(begin(text), end(text), '\n'));
+		if (num_lines != num_expected_lines) {
+			throw std::runtime_error("burst " + std::to_string(iburst) + " wrote " + std::to_string(num_lines)
+				+ " lines instead of " + std::to_string(num_expected_lines));
+		}
+	}
+
+	printer.stopAsyncWriter();
+}
+
+int main() {
+	async_writer_drains_every_burst();
+}
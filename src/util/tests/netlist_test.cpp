@@ -1,5 +1,8 @@
+#include "../frozen_netlist.hpp"
 #include "../netlist.hpp"
 
+#include <vector>
+
 using namespace util;
 
 template<bool IS_TREE>
@@ -54,6 +57,89 @@ void root_replacement() {
 	}
 }
 
+void connection_removal() {
+	Netlist<int> nlist;
+
+	nlist.addConnection(1, 2);
+	nlist.addConnection(2, 3);
+	nlist.addConnection(1, 4);
+
+	nlist.removeConnection(1, 2);
+
+	const auto& roots = nlist.roots();
+	if (std::distance(begin(roots), end(roots)) != 2 || roots.find(2) == end(roots)) {
+		throw std::runtime_error("removed sink with fanout should become a root");
+	}
+
+	nlist.removeConnection(1, 4);
+	nlist.removeConnection(2, 3);
+
+	if (!nlist.empty()) {
+		throw std::runtime_error("nodes left with no connections should be gone");
+	}
+}
+
+void tree_removal() {
+	Netlist<int> nlist;
+
+	nlist.addConnection(1, 2);
+	nlist.addConnection(2, 3);
+	nlist.addConnection(2, 4);
+	nlist.addConnection(5, 6);
+
+	const auto removed = nlist.removeTree(1);
+	if (removed.size() != 4) {
+		throw std::runtime_error("didn't remove the whole tree");
+	}
+
+	const auto all_ids = nlist.all_ids();
+	if (std::distance(begin(all_ids), end(all_ids)) != 2 || nlist.roots().find(5) == end(nlist.roots())) {
+		throw std::runtime_error("removed too much");
+	}
+}
+
+template<typename Range>
+std::vector<int> as_vector(const Range& range) {
+	std::vector<int> result;
+	for (const auto& elem : range) {
+		result.push_back(elem);
+	}
+	return result;
+}
+
+void frozen_matches_netlist() {
+	Netlist<int> nlist;
+
+	nlist.addConnection(1, 2);
+	nlist.addConnection(2, 3);
+	nlist.addConnection(2, 4);
+	nlist.addConnection(1, 5);
+	nlist.addConnection(6, 7);
+
+	const FrozenNetlist<int> frozen(nlist);
+
+	if (as_vector(nlist.roots()) != as_vector(frozen.roots())) {
+		throw std::runtime_error("roots differ");
+	}
+	for (const auto& id : nlist.all_ids()) {
+		if (as_vector(nlist.fanout(id)) != as_vector(frozen.fanout(id))) {
+			throw std::runtime_error("fanout differs");
+		}
+	}
+	if (!frozen.isRoot(6) || frozen.isRoot(7) || !frozen.fanout(8).empty()) {
+		throw std::runtime_error("bad lookup");
+	}
+
+	std::vector<std::pair<int, int>> visited; // (node, depth)
+	frozen.for_all_descendants(2, 0, [&](int id, int depth) {
+		visited.emplace_back(id, depth);
+		return depth + 1;
+	});
+	if (visited.size() != 3 || visited.front() != std::make_pair(2, 0) || visited[1].second != 1 || visited[2].second != 1) {
+		throw std::runtime_error("bad traversal");
+	}
+}
+
 int main() {
 	shorting_trees_test<true>();
 	shorting_trees_test<false>();
@@ -63,4 +149,8 @@ int main() {
 
 	root_replacement<true>();
 	root_replacement<false>();
+
+	connection_removal();
+	tree_removal();
+	frozen_matches_netlist();
 }
@@ -2,6 +2,8 @@
 #ifndef UTILS__TUPLE_UTILS_HPP
 #define UTILS__TUPLE_UTILS_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <tuple>
 
 namespace util {